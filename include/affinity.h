@@ -0,0 +1,32 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+typedef enum {
+    BIND_NONE,      // leave placement to the OS
+    BIND_COMPACT,   // fill hardware threads in order, SMT siblings next to each other
+    BIND_SPREAD,    // space the threads evenly over the physical cores
+    BIND_CORE,      // one thread per physical core, cores in order
+    BIND_NUMA       // each thread may run anywhere in its NUMA domain, domains dealt round-robin
+} BindPolicy;
+
+const char* bind_policy_name(BindPolicy policy);
+
+// Parses a --bind argument, returns -1 for unknown names
+int bind_policy_parse(const char* name);
+
+// Collective over MPI_COMM_WORLD: reads the topology of the CPUs this process may use and
+// binds the main thread of every rank to the first place of its share of the node
+void affinity_init(BindPolicy policy);
+
+// Binds the OpenMP team of the calling rank within the share of the node of the rank, starting
+// at its main thread, and records the placement for the following results
+void affinity_bind_team(int threads);
+
+// Placement of the last team, CPU lists of its threads separated by ';' (empty when unbound)
+const char* affinity_team_placement();
+
+// Placement of the main threads of the first `ranks` ranks of MPI_COMM_WORLD, gathered at init
+// on rank 0 (empty when unbound)
+const char* affinity_rank_placement(int ranks);
+
+#endif // !AFFINITY_H
@@ -0,0 +1,30 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+// One tuned winner, keyed by (cpu_model, n, threads)
+typedef struct {
+    char cpu_model[128];
+    int n;
+    int threads;
+    char kernel[64];
+    int block_size;
+    double seconds;
+} WisdomEntry;
+
+// Name of the CPU as reported by /proc/cpuinfo, "unknown" if unavailable
+const char* autotune_cpu_model();
+
+// Loads the wisdom file, replacing whatever was loaded before. Returns the number of entries.
+int wisdom_load(const char* path);
+
+// Best known entry for this CPU, n and thread count (nearest n if there is no exact match)
+const WisdomEntry* wisdom_lookup(int n, int threads);
+
+// Times the candidate kernels for (n, threads) over a pruned parameter space,
+// stores the winner in the wisdom file and returns it
+const WisdomEntry* autotune(int n, int threads, const char* wisdom_path);
+
+// Dispatches to the tuned kernel for the current thread count, falling back to transpose_omp
+float** transpose_auto(float** matrix, int n, long double* time);
+
+#endif // !AUTOTUNE_H
@@ -2,6 +2,9 @@
 #define CONFIG_H
 
 #include <mpi.h>
+#include <stddef.h>
+
+#define MAX_SPARSE_DENSITIES 16
 
 typedef struct {
     int CURR_RUN;
@@ -14,11 +17,42 @@ typedef struct {
     int MAX_BLOCK_SIZE;
     int BLOCK_SIZE;
     int NUM_RUNS;
+    int WARMUP_RUNS;
     int BENCHMARK_FULL;
     int MIN_OMP_THREADS;
     int MAX_OMP_THREADS;
     int OMP_THREADS;
+    int AUTOTUNE;
+    int PERF_COUNTERS;
+    int STREAM_BASELINE;
+    int THREAD_STATS;
+    int BIND_POLICY;
+    int MPI_STAGING_MB;
+    int SYMMETRY_MODE;          // SymmetryMode of the check_symmetry_* entries
+    double SYMMETRY_TOLERANCE;
+    int MIN_PREFETCH_DISTANCE;
+    int MAX_PREFETCH_DISTANCE;
+    int PREFETCH_DISTANCE;      // rows ahead of the strided accesses, 0 is off, -1 while a kernel without prefetch runs
+    double SPARSE_DENSITIES[MAX_SPARSE_DENSITIES];
+    int NUM_SPARSE_DENSITIES;
+    double SPARSE_DENSITY;      // of the sparse entry being run, -1 otherwise
+    const char* WISDOM_PATH;
+    const char* INPUT_PATH;     // matrix file benchmarked instead of random matrices, or NULL
+    size_t INPUT_BYTES;         // its size, once loaded
+    const char* RESULTS_FILE;
+    const char* KERNEL_FILTER;
+    const char* KERNEL_EXCLUDE;
     MPI_Comm CURR_COMM;
+    float** RESULT;
+    struct MPIPlan* MPI_PLAN;
+    struct OMPPlan* OMP_PLAN;
+    struct InplacePlan* INPLACE_PLAN;
+    float* INPLACE_DATA;        // contiguous copy of MATRIX for the in-place kernels
+    int INPLACE_TRANSPOSED;     // whether INPLACE_DATA currently holds the transpose
+    int SYMMETRIZE_MODE;        // SymmetrizeMode of the symmetrize_omp entry being run
+    struct TrackedMatrix* TRACKED;  // symmetric copy of MATRIX in RESULT for the tracked entries
+    struct CSRMatrix* SPARSE;   // random symmetric matrix of the sparse entry being run
+    struct PackedMatrix* PACKED;    // packed form of MATRIX for the packed conversion entries
 } Config;
 
 // Function to initialize the configuration
@@ -0,0 +1,22 @@
+#ifndef FUSED_H
+#define FUSED_H
+
+// BLAS-like out-of-place operations in the style of MKL's mkl_somatcopy and mkl_somatadd, on
+// n x n row-pointer matrices. op(X) is X for trans 'N' and Xᵀ for 'T'; the matrices are real,
+// so there is no conjugating variant. Both are tiled by block_size, split over the OpenMP
+// threads and vectorised along the contiguous output rows, so the scaling and accumulation
+// ride on the same pass over memory as the transpose itself.
+
+// B = alpha * op(A)
+void somatcopy_omp(char trans, int n, float alpha, float** a, float** b, int block_size, long double* time);
+
+// C = alpha * op(A) + beta * op(B). C may be B itself when transb is 'N', which accumulates
+// alpha * op(A) into B. With beta == 0, B is not read.
+void somatadd_omp(char transa, char transb, int n, float alpha, float** a, float beta, float** b, float** c,
+                  int block_size, long double* time);
+
+// Reference for somatadd_omp with transa 'T' and c == b, done the unfused way: a tiled
+// transpose into a temporary, then a second pass B = alpha * T + beta * B
+void somatadd_unfused_omp(int n, float alpha, float** a, float beta, float** b, int block_size, long double* time);
+
+#endif // !FUSED_H
@@ -0,0 +1,48 @@
+#ifndef INPLACE_H
+#define INPLACE_H
+
+#include <stddef.h>
+
+// A piece of a long cycle of the transpose permutation. Positions follow the forward
+// direction: the element at start is carried to the position after it, and so on up to end,
+// which is the start of the next piece of the same cycle.
+typedef struct {
+    size_t start;
+    size_t end;
+    size_t moves;
+} InplaceSegment;
+
+// In-place transpose plan of a contiguous rows x cols buffer. The cycle leaders are found once
+// at creation with a bit-vector; executing only moves data. Cycles are disjoint, so short
+// cycles are dealt to the threads in batches and long cycles are cut into segments that run
+// in parallel, each starting from a carried copy of its first element.
+typedef struct InplacePlan {
+    int rows;
+    int cols;
+    int threads;
+
+    size_t* leaders;            // one position per short cycle
+    size_t num_leaders;
+    size_t* batch_first;        // batch b walks the cycles of leaders[batch_first[b], batch_first[b + 1])
+    size_t num_batches;
+
+    InplaceSegment* segments;
+    size_t num_segments;
+    float* carries;             // per segment, refilled by every execute
+
+    double create_time;         // seconds spent in the leader pass
+} InplacePlan;
+
+// Returns NULL when the arguments are invalid or memory runs out
+InplacePlan* inplace_plan_create(int rows, int cols, int threads);
+
+// inverse = 0 turns the rows x cols buffer into its cols x rows transpose,
+// inverse = 1 turns that cols x rows buffer back into rows x cols
+void inplace_plan_execute(InplacePlan* plan, float* data, int inverse, long double* time);
+
+void inplace_plan_destroy(InplacePlan* plan);
+
+// One-shot in-place transpose of a contiguous rows x cols buffer, time covers the plan as well
+void transpose_inplace(float* data, int rows, int cols, int threads, long double* time);
+
+#endif // !INPLACE_H
@@ -0,0 +1,66 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdio.h>
+
+typedef enum {
+    KERNEL_SEQUENTIAL,
+    KERNEL_IMPLICIT,
+    KERNEL_OMP,
+    KERNEL_PLAN,
+    KERNEL_MPI,
+    NUM_KERNEL_FAMILIES
+} KernelFamily;
+
+// Sweep parameters that change the result of a kernel, the planner only varies these
+#define KERNEL_USES_THREADS 0x1     // thread count, or rank count for MPI kernels
+#define KERNEL_USES_BLOCK   0x2     // cfg->BLOCK_SIZE
+#define KERNEL_NEEDS_MPI    0x4     // run collectively by every rank of CURR_COMM
+#define KERNEL_REPLICATES   0x8     // holds the whole matrix on every rank, not only on the root
+#define KERNEL_STREAMS      0x10    // MPI kernel that never flattens the matrix on the root
+#define KERNEL_PREFETCHES   0x20    // cfg->PREFETCH_DISTANCE, swept inside the entry by kernel_run
+#define KERNEL_SPARSE       0x40    // cfg->SPARSE_DENSITY, swept by kernel_run with a setup per density
+#define KERNEL_LOADS        0x80    // reads cfg->INPUT_PATH, only planned with --input
+
+typedef struct {
+    const char* name;
+    KernelFamily family;
+    int flags;
+    void (*wrapper)(long double*);
+    // Optional, build and release per-entry state (plans) outside the timed runs. A setup
+    // returns 0, or -1 when the entry cannot run, which skips it; teardown runs either way.
+    int (*setup)(int arg);
+    void (*teardown)(void);
+    int arg;
+    // Optional, bytes the entry has to move at least at dimension n, for the bandwidth columns.
+    // NULL leaves them empty: checks that stop at the first mismatch read an unknown share.
+    double (*bytes_moved)(int n);
+} KernelDesc;
+
+extern const KernelDesc kernel_registry[];
+extern const int num_kernels;
+
+const char* kernel_family_name(KernelFamily family);
+
+// Checks that every pattern of a comma separated --kernels/--exclude list matches a kernel.
+// Patterns are fnmatch globs on the kernel name, or a family name.
+int kernel_patterns_valid(const char* patterns, const char** unknown, int* unknown_len);
+
+// Applies cfg->KERNEL_FILTER and cfg->KERNEL_EXCLUDE
+int kernel_selected(const KernelDesc* kernel);
+
+// Whether the planner runs the kernel at this (threads, block size) point of the sweep:
+// parameters the kernel does not use are only visited at the first value of their range
+int kernel_planned(const KernelDesc* kernel, int threads, int block_size);
+
+// Number of kernels planned at this thread count for any block size, with the given flags set
+int kernels_planned_count(int threads, int flags);
+
+// Benchmarks the kernel with benchmark_function or benchmark_mpi_function, once per prefetch
+// distance of the range for kernels with KERNEL_PREFETCHES and once per density for kernels
+// with KERNEL_SPARSE
+void kernel_run(const KernelDesc* kernel);
+
+void kernel_list(FILE* fp);
+
+#endif // !KERNELS_H
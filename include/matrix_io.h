@@ -0,0 +1,38 @@
+#ifndef MATRIX_IO_H
+#define MATRIX_IO_H
+
+#include <stddef.h>
+
+typedef enum {
+    INPUT_MATRIX_MARKET,
+    INPUT_NPY
+} InputFormat;
+
+// A square matrix read from a file, as the float** rows the kernels take
+typedef struct {
+    float** matrix;
+    int n;
+    InputFormat format;
+    size_t bytes;           // size of the file
+    double seconds;         // wall time of the whole load
+    void* map;              // when not NULL the rows point into this private mapping of the file
+    size_t map_length;
+} InputMatrix;
+
+// Loads a MatrixMarket (.mtx) or NumPy (.npy) file, told apart by their magic bytes, with the
+// current OpenMP thread count. Returns 0, or -1 after printing the reason on stderr.
+//
+// MatrixMarket: coordinate or array, real, integer or pattern, general, symmetric or
+// skew-symmetric. The file is mapped and split into byte ranges that start on a line, and
+// every thread parses its own range with its own number parser.
+//
+// NumPy: 2-D square '<f4' or '<f8', in C or Fortran order. '<f4' in C order is used in place:
+// the rows point into a private, prefaulted mapping of the file and nothing is copied. The
+// other layouts are converted into new rows in parallel.
+int input_load(const char* path, InputMatrix* input);
+
+void input_release(InputMatrix* input);
+
+const char* input_format_name(InputFormat format);
+
+#endif // !MATRIX_IO_H
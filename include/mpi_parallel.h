@@ -3,6 +3,15 @@
 
 #include <mpi.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+// Committed type of `len` contiguous floats, released with MPI_Type_free. Transfers are
+// counted in rows (or columns, or pieces of rows) rather than in floats, so the int counts of
+// MPI stay in range once a message holds 2^31 elements or more.
+MPI_Datatype mpi_row_type(int len);
+
+// Copies the rows of the matrix into one contiguous buffer, NULL when out of memory
+float* flatten_matrix(float** matrix, int n);
 
 bool is_symmetric_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size, long double* time, int verbosity);
 
@@ -14,4 +23,10 @@ float** block_cyclic_transpose_mpi(MPI_Comm comm, float** matrix, int n, int ran
 
 float** nonblocking_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size, long double* time, int verbosity);
 
+// Row-block transpose that never flattens on the root: rows are packed from the source rows and
+// transposed blocks unpacked into the preallocated result (root) through a staging buffer of
+// staging_bytes, so the root holds 2 * n * n floats plus the buffer
+void streaming_transpose_mpi(MPI_Comm comm, float** matrix, float** result, int n, int rank, int size,
+                             size_t staging_bytes, long double* time, int verbosity);
+
 #endif // !MPI_PARALLEL_H
@@ -0,0 +1,35 @@
+#ifndef MPI_PHASES_H
+#define MPI_PHASES_H
+
+typedef enum {
+    PHASE_SETUP,        // communicators and datatypes
+    PHASE_FLATTEN,      // packing the root matrix into a contiguous buffer
+    PHASE_DISTRIBUTE,   // scatter or broadcast from the root
+    PHASE_COMPUTE,      // local transposes, packing and comparisons
+    PHASE_EXCHANGE,     // rank to rank communication
+    PHASE_GATHER,       // collecting the result on the root
+    PHASE_REBUILD,      // create_2d_matrix or unpacking into the result rows
+    NUM_MPI_PHASES
+} MPIPhase;
+
+// CSV prefix of each phase
+extern const char* mpi_phase_names[NUM_MPI_PHASES];
+
+// Breakdown of the last MPI kernel call on this rank
+typedef struct {
+    double seconds[NUM_MPI_PHASES];
+    double total;
+} MPIPhaseTimes;
+
+// Clears the breakdown and returns the start timestamp of the call
+double mpi_phases_begin();
+
+// Charges the time since *mark to phase and moves the mark to now
+void mpi_phase_end(MPIPhase phase, double* mark);
+
+// Records and returns the end-to-end time of the call started at start
+double mpi_phases_finish(double start);
+
+const MPIPhaseTimes* mpi_phases_last();
+
+#endif // !MPI_PHASES_H
@@ -0,0 +1,54 @@
+#ifndef MPI_PLAN_H
+#define MPI_PLAN_H
+
+#include <mpi.h>
+
+// Distribution strategy executed by a plan
+typedef enum {
+    MPI_PLAN_ROW_BLOCK,     // scatter row blocks, transpose locally, gather column blocks
+    MPI_PLAN_ALLTOALL,      // scatter row blocks, exchange square blocks, gather row blocks
+    MPI_PLAN_BLOCK_2D       // 2D process grid, subarray blocks scattered and gathered
+} MPIPlanAlgorithm;
+
+// A transpose plan holds everything the execute step needs: the communicator,
+// derived datatypes, persistent requests and preallocated buffers.
+// Create and destroy are collective over the communicator.
+typedef struct MPIPlan {
+    MPIPlanAlgorithm algorithm;
+    MPI_Comm comm;
+    int n;
+    int rank;
+    int size;
+
+    // Shape of the block owned by this rank
+    int local_rows;
+    int local_cols;
+
+    float* send_flat;       // root: packed source matrix
+    float* recv_flat;       // root: packed transposed matrix
+    float* local;           // local block as received
+    float* local_t;         // local block after the local transpose
+    float* exchange;        // alltoall only: blocks received from every rank
+
+    MPI_Datatype* types;
+    int num_types;
+
+    MPI_Request* scatter_reqs;
+    int num_scatter;
+    MPI_Request* exchange_reqs;
+    int num_exchange;
+    MPI_Request* gather_reqs;
+    int num_gather;
+} MPIPlan;
+
+const char* mpi_plan_algorithm_name(MPIPlanAlgorithm algorithm);
+
+// Returns NULL on every rank when n cannot be distributed over the communicator
+MPIPlan* mpi_plan_create(MPI_Comm comm, int n, MPIPlanAlgorithm algorithm);
+
+// Transposes matrix (root) into result (root, preallocated n x n). Only moves data.
+void mpi_plan_execute(MPIPlan* plan, float** matrix, float** result, long double* time);
+
+void mpi_plan_destroy(MPIPlan* plan);
+
+#endif // !MPI_PLAN_H
@@ -15,4 +15,14 @@ float ** transpose_omp_tasks(float **matrix, int n, int tile_size, long double*
 
 float ** transpose_cache_oblivious(float **matrix, int n, long double* time);
 
+typedef enum {
+    SYMMETRIZE_AVERAGE,             // A <- (A + Aᵀ) / 2
+    SYMMETRIZE_UPPER_TO_LOWER,      // the lower triangle becomes a copy of the upper one
+    SYMMETRIZE_LOWER_TO_UPPER
+} SymmetrizeMode;
+
+// Makes the matrix exactly symmetric in place. Threads take the tile pairs (i, j), (j, i)
+// of the upper triangle, so each mirrored pair is read once and both halves written back.
+void symmetrize_omp(float **matrix, int n, int block_size, SymmetrizeMode mode, long double* time);
+
 #endif // !PARALLEL_H
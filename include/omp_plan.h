@@ -0,0 +1,45 @@
+#ifndef OMP_PLAN_H
+#define OMP_PLAN_H
+
+// How the tiles of the output are shaped and handed out to threads
+typedef enum {
+    OMP_PLAN_NAIVE,                 // one output row per tile, contiguous rows per thread
+    OMP_PLAN_BLOCK_BASED,           // square tiles, contiguous run of tiles per thread
+    OMP_PLAN_TILE_DISTRIBUTED,      // square tiles, whole tile rows dealt round-robin
+    OMP_PLAN_TASKS,                 // square tiles dealt round-robin one by one
+    OMP_PLAN_IMPLICIT,              // single thread, one vectorized sweep
+    OMP_PLAN_IMPLICIT_BLOCK_BASED   // single thread, square tiles in row-major order
+} OMPPlanStrategy;
+
+typedef struct {
+    int row_start;
+    int row_end;
+    int col_start;
+    int col_end;
+} OMPPlanTile;
+
+// A shared-memory transpose plan: the tile list and the static per-thread
+// assignment are computed once, so executing it never allocates or reads the config.
+typedef struct OMPPlan {
+    OMPPlanStrategy strategy;
+    int n;
+    int tile_rows;
+    int tile_cols;
+    int threads;
+
+    int num_tiles;
+    OMPPlanTile* tiles;     // grouped by thread
+    int* thread_first;      // tiles of thread t are [thread_first[t], thread_first[t + 1])
+} OMPPlan;
+
+const char* omp_plan_strategy_name(OMPPlanStrategy strategy);
+
+// Returns NULL when the arguments are invalid or memory runs out
+OMPPlan* omp_plan_create(int n, OMPPlanStrategy strategy, int tile_rows, int tile_cols, int threads);
+
+// dst must be a preallocated n x n matrix distinct from src
+void omp_plan_execute(const OMPPlan* plan, float** src, float** dst, long double* time);
+
+void omp_plan_destroy(OMPPlan* plan);
+
+#endif // !OMP_PLAN_H
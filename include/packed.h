@@ -0,0 +1,65 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <mpi.h>
+#include <stddef.h>
+
+// A symmetric n x n matrix in rectangular full packed form (LAPACK RFP, TRANSR = 'N', UPLO = 'L'):
+// the n(n+1)/2 elements of the lower triangle are rearranged into a full ld x k rectangle,
+// stored column by column. For n even ld = n + 1 and k = n / 2, for n odd ld = n and
+// k = (n + 1) / 2. Unlike plain packed storage every column has the same length, so the
+// rectangle can be tiled, split by columns and shipped like a dense block.
+typedef struct PackedMatrix {
+    int n;
+    int ld;
+    int k;
+    float* data;    // ld * k floats, element (i, j) of the rectangle at j * ld + i
+} PackedMatrix;
+
+// Columns [first_col, first_col + cols) of the rectangle, as held by one rank
+typedef struct {
+    int n;
+    int ld;
+    int first_col;
+    int cols;
+    float* data;    // ld * cols floats
+} PackedBlock;
+
+// NULL when out of memory
+PackedMatrix* packed_create(int n);
+
+void packed_destroy(PackedMatrix* packed);
+
+// Offset in data of element (i, j) of the symmetric matrix, either triangle
+static inline size_t packed_offset(const PackedMatrix* packed, int i, int j) {
+    int r = i > j ? i : j, c = i > j ? j : i;
+    int odd = packed->n & 1;
+    if (c < packed->k) {
+        return (size_t)c * packed->ld + r + !odd;
+    }
+    return (size_t)(r - packed->k + odd) * packed->ld + (c - packed->k);
+}
+
+// Packs the upper triangle of matrix, which is all of it for a symmetric matrix. Tiles of
+// block_size x block_size of the rectangle are spread over the threads.
+void dense_to_packed_omp(float** matrix, PackedMatrix* packed, int block_size, long double* time);
+
+// Writes both triangles of matrix
+void packed_to_dense_omp(const PackedMatrix* packed, float** matrix, int block_size, long double* time);
+
+// Rank r gets an even share of the columns of the root's rectangle. packed is only read on
+// the root, n is needed everywhere.
+PackedBlock* packed_scatter_mpi(MPI_Comm comm, const PackedMatrix* packed, int n, int rank, int size);
+
+// Inverse of packed_scatter_mpi, packed is only written on the root
+void packed_gather_mpi(MPI_Comm comm, const PackedBlock* block, PackedMatrix* packed, int rank, int size);
+
+void packed_block_destroy(PackedBlock* block);
+
+// Distribution of a symmetric matrix through the packed form, as transpose_mpi does with the
+// full square: the root packs matrix, scatters the columns of the rectangle, gathers them back
+// and unpacks them into result. Half the bytes of a dense scatter and gather go over the network.
+void packed_scatter_gather_mpi(MPI_Comm comm, float** matrix, float** result, int n, int rank, int size,
+                               int block_size, long double* time, int verbosity);
+
+#endif // !PACKED_H
@@ -0,0 +1,42 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_STALLED_BACKEND,
+    PERF_NUM_EVENTS
+} PerfEvent;
+
+// Counter totals over every instrumented thread. An event that could not be opened
+// on some thread is marked unavailable rather than reported as a partial count.
+typedef struct {
+    long long values[PERF_NUM_EVENTS];
+    int available[PERF_NUM_EVENTS];
+} PerfCounts;
+
+// CSV column name of each event
+extern const char* perf_event_names[PERF_NUM_EVENTS];
+
+// Opens the counters on each of the first `threads` OpenMP threads (the calling thread when 1).
+// Returns the number of events that could be opened; 0 means counters are unavailable.
+int perf_counters_open(int threads);
+
+// Resets the counters and lets the next timed regions enable them
+void perf_counters_arm();
+
+// Called by the kernels around their timed region, next to the clock_gettime pair. Nested
+// regions count once, and both are no-ops unless the counters are armed.
+void perf_counters_begin();
+void perf_counters_end();
+
+// Disables the counters, even if an error path left a region open, and adds their values to counts
+void perf_counters_disarm(PerfCounts* counts);
+
+void perf_counters_close();
+
+void perf_counts_clear(PerfCounts* counts);
+
+#endif // !PERF_COUNTERS_H
@@ -0,0 +1,19 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <stdio.h>
+
+// Writes the column names of benchmark_results.csv, shared by every results file
+void write_results_header(FILE* fp);
+
+// Writes "# key: value" lines describing the build, the machine and the launch
+void write_run_metadata(FILE* fp, int argc, char* argv[]);
+
+// Creates a results file of its own for this run in dir, starting with the metadata and
+// the column names. Returns its path, or NULL if it could not be created.
+const char* create_run_results(const char* dir, int argc, char* argv[]);
+
+// Appends a row to benchmark_results.csv and to the file of this run, if any
+void append_result_row(const char* row);
+
+#endif // !RESULTS_H
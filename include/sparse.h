@@ -0,0 +1,48 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+// Compressed sparse row storage. The transpose of a CSR matrix is the same matrix in
+// compressed sparse column form, so CSC is a CSRMatrix of the transposed shape.
+typedef struct CSRMatrix {
+    int rows;
+    int cols;
+    long long nnz;
+    long long* row_ptr;     // rows + 1 offsets into col_idx and values
+    int* col_idx;           // ascending within a row
+    float* values;
+} CSRMatrix;
+
+typedef enum {
+    SPARSE_ASYMMETRIC,
+    SPARSE_STRUCTURALLY_SYMMETRIC,  // (i, j) is stored exactly when (j, i) is, values differ
+    SPARSE_SYMMETRIC
+} SparseSymmetry;
+
+// Arrays sized for nnz entries, row_ptr left to the caller. NULL when out of memory.
+CSRMatrix* csr_create(int rows, int cols, long long nnz);
+
+void csr_destroy(CSRMatrix* matrix);
+
+// Zeros are dropped. Rows are counted in parallel, then filled in parallel. The time covers
+// both passes and the allocation of the result, whose size is only known after the count.
+CSRMatrix* csr_from_dense_omp(float** matrix, int rows, int cols, long double* time);
+
+// Released with deallocate_matrix(dense, rows)
+float** csr_to_dense(const CSRMatrix* matrix);
+
+// n x n with a full diagonal and every pair (i, j), i != j, stored on both sides with
+// probability density. Rows are drawn from seed + i, so the matrix does not depend on the
+// thread count.
+CSRMatrix* csr_random_symmetric(int n, double density, unsigned int seed);
+
+// CSR to CSC. Every thread takes a contiguous range of rows holding about nnz / threads entries,
+// counts its entries per column, the counts are turned into per-thread column offsets by a
+// parallel prefix sum, and every thread scatters its rows in order, so the rows of each column
+// come out sorted.
+CSRMatrix* csr_transpose_omp(const CSRMatrix* matrix, long double* time);
+
+// Every stored (i, j) is looked up in row j by binary search, rows in parallel. Stops at the
+// first missing mirror.
+SparseSymmetry csr_is_symmetric_omp(const CSRMatrix* matrix, long double* time);
+
+#endif // !SPARSE_H
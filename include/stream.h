@@ -0,0 +1,20 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+// Smallest number of doubles in each STREAM array, raised to four times the last level cache
+#define STREAM_MIN_ARRAY_SIZE (1 << 22)
+#define STREAM_REPETITIONS 5
+
+typedef struct {
+    int threads;
+    double copy_gbps;
+    double triad_gbps;
+} StreamResult;
+
+// Runs the copy and triad kernels with the given number of threads and caches the result
+const StreamResult* stream_calibrate(int threads);
+
+// Cached calibration for a thread count, NULL if it was never calibrated
+const StreamResult* stream_result(int threads);
+
+#endif // !STREAM_H
@@ -0,0 +1,43 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <mpi.h>
+
+typedef enum {
+    SYMMETRY_ABS,       // |a - b|
+    SYMMETRY_REL,       // |a - b| / max(|a|, |b|)
+    SYMMETRY_ULP,       // representable floats between a and b
+    NUM_SYMMETRY_MODES
+} SymmetryMode;
+
+typedef struct {
+    SymmetryMode mode;
+    double tolerance;   // a pair violates symmetry when its deviation is above this
+} SymmetryTolerance;
+
+// How far a matrix is from symmetric, over the pairs (i, j) with i < j. A NaN on either
+// side, or an overflowing difference, counts as an infinite deviation.
+typedef struct {
+    double max_deviation;       // in the unit of the mode
+    int row;                    // location of the largest deviation (row < col), -1 when
+    int col;                    // the matrix is exactly symmetric
+    long long violations;       // pairs above the tolerance
+} SymmetryReport;
+
+const char* symmetry_mode_name(SymmetryMode mode);
+
+// Parses "<mode>:<tolerance>" with mode abs, rel or ulp, returns 0 when malformed
+int symmetry_tolerance_parse(const char* arg, SymmetryTolerance* tolerance);
+
+// Tiled over the mirrored tile pairs of the upper triangle, each row of a tile is a SIMD
+// max and count reduction
+SymmetryReport check_symmetry_omp(float** matrix, int n, SymmetryTolerance tolerance, int block_size,
+                                  long double* time);
+
+// Row blocks are scattered from the root and every rank swaps the mirrored blocks it needs with
+// one all-to-all, so each pair is compared once, on the rank that owns its row. Every rank
+// returns the full report.
+SymmetryReport check_symmetry_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size,
+                                  SymmetryTolerance tolerance, long double* time, int verbosity);
+
+#endif // !SYMMETRY_H
@@ -0,0 +1,29 @@
+#ifndef THREAD_STATS_H
+#define THREAD_STATS_H
+
+// Work of one OpenMP thread, summed over the instrumented runs of an entry
+typedef struct {
+    double busy;    // seconds spent inside its share of the work
+    double idle;    // seconds of the parallel region spent waiting, mostly at the barrier
+    long items;     // tiles, rows or elements handed to the thread, depending on the kernel
+} ThreadSample;
+
+// Arms the recording for the next kernel call on up to `threads` threads.
+// Kernels called while it is not armed (warm-ups, autotuning) skip every clock read.
+void thread_stats_reset(int threads);
+
+// Disarms the recording and adds this call's per-thread samples to samples[0..threads)
+void thread_stats_collect(ThreadSample* samples, int threads);
+
+// Called by each thread where its share of the region starts. Returns the timestamp
+// to pass on, or 0 when not armed.
+double thread_stats_begin();
+
+// Charges the time since start and `items` units of work to the calling thread
+void thread_stats_busy(double start, long items);
+
+// Called by each thread after the closing barrier: the rest of the region since
+// region_start that was not charged as busy is idle time
+void thread_stats_end(double region_start);
+
+#endif // !THREAD_STATS_H
@@ -0,0 +1,19 @@
+#ifndef TILES_H
+#define TILES_H
+
+// Transposes the tile of result rows [i, i + size) and columns [j, j + size) from matrix,
+// with size fixed at compile time so the loops carry no bounds checks. When ahead > 0 the
+// column walk prefetches the source row that many rows further down, which must exist.
+typedef void (*TileKernel)(float** matrix, float** result, int i, int j, int ahead);
+
+#define MIN_FIXED_TILE 4
+#define MAX_FIXED_TILE 256
+
+// Instance for a power of two size between MIN_FIXED_TILE and MAX_FIXED_TILE, NULL otherwise
+TileKernel tile_kernel(int size);
+
+// Runtime sized path for edge tiles and sizes without an instance: rows x cols of the result
+// starting at (i, j)
+void transpose_tile(float** matrix, float** result, int i, int j, int rows, int cols);
+
+#endif // !TILES_H
@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timeline tracing, compiled in with `make trace` (-DPARCO_TRACE). Without the flag every
+// macro expands to nothing, so the instrumented code is identical to an untraced build.
+//
+// Events go to a buffer owned by the calling thread and are merged over all ranks into a
+// Chrome trace (chrome://tracing, ui.perfetto.dev) by TRACE_WRITE at exit, with one
+// process per rank and one track per thread.
+
+#ifdef PARCO_TRACE
+
+// Maximum number of events kept per thread, later events are dropped and counted
+#define TRACE_MAX_EVENTS (1 << 21)
+
+// Collective over MPI_COMM_WORLD: aligns the clocks of the ranks on a barrier
+void trace_init();
+
+// The name is stored by pointer and must outlive the run, as string literals do
+void trace_begin(const char* name);
+void trace_end(const char* name);
+
+// An event of the given length that ends now, for spans timed by another clock
+void trace_span(const char* name, double seconds);
+
+// Stable copy of a name built at runtime
+const char* trace_intern(const char* name);
+
+// Collective over MPI_COMM_WORLD: rank 0 writes the events of every rank to path
+void trace_write(const char* path);
+
+#define TRACE_INIT() trace_init()
+#define TRACE_BEGIN(name) trace_begin(name)
+#define TRACE_END(name) trace_end(name)
+#define TRACE_BEGIN_DYNAMIC(name) trace_begin(trace_intern(name))
+#define TRACE_END_DYNAMIC(name) trace_end(trace_intern(name))
+#define TRACE_SPAN(name, seconds) trace_span(name, seconds)
+#define TRACE_WRITE(path) trace_write(path)
+
+#else
+
+#define TRACE_INIT() ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_BEGIN_DYNAMIC(name) ((void)0)
+#define TRACE_END_DYNAMIC(name) ((void)0)
+#define TRACE_SPAN(name, seconds) ((void)0)
+#define TRACE_WRITE(path) ((void)0)
+
+#endif // PARCO_TRACE
+
+#endif // !TRACE_H
@@ -0,0 +1,46 @@
+#ifndef TRACKED_H
+#define TRACKED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+    TILE_PAIR_UNKNOWN,
+    TILE_PAIR_SYMMETRIC,
+    TILE_PAIR_ASYMMETRIC
+};
+
+// A matrix whose symmetry is re-checked incrementally. Writes through tracked_set, or writes
+// made directly and then reported with tracked_mark_dirty, set the bit of their tile. A
+// re-check only compares the tile pairs (I, J), (J, I) with a dirty side and keeps the state
+// of every other pair, so its cost follows the changed area instead of n².
+typedef struct TrackedMatrix {
+    float** matrix;             // borrowed, not freed by tracked_destroy
+    int n;
+    int tile;
+    int tiles;                  // per side
+
+    uint64_t* dirty;            // bit I * tiles + J per tile
+    size_t dirty_words;
+    uint8_t* pair_state;        // TILE_PAIR_* at I * tiles + J, I <= J
+    long long asymmetric_pairs;
+
+    long long checked_pairs;    // pairs compared by the last re-check
+} TrackedMatrix;
+
+// Every tile starts dirty, so the first re-check is a full one. NULL when out of memory.
+TrackedMatrix* tracked_create(float** matrix, int n, int tile);
+
+void tracked_destroy(TrackedMatrix* tracked);
+
+// matrix[i][j] = value. Safe to call from several threads.
+void tracked_set(TrackedMatrix* tracked, int i, int j, float value);
+
+// Reports writes to rows [row, row + rows) and columns [col, col + cols) made directly
+void tracked_mark_dirty(TrackedMatrix* tracked, int row, int col, int rows, int cols);
+
+// Exact comparison like is_symmetric_omp, over the dirty tile pairs only
+bool tracked_is_symmetric(TrackedMatrix* tracked, long double* time);
+
+#endif // !TRACKED_H
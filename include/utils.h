@@ -1,6 +1,8 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stddef.h>
+
 void print_matrix(float** matrix, int n);
 
 void correct_transpose(float** m1, float** m2, int n);
@@ -13,7 +15,37 @@ void print_loading_bar(int progress, int total);
 
 void deallocate_matrix(float** matrix, int n);
 
-void benchmark_function(void (*func)(long double*), const char* func_name);
+float** allocate_matrix(int n);
+
+void* allocate_aligned(size_t bytes);
+
+// Bytes `rank` holds at the peak of a sweep point of an n x n matrix over `ranks` ranks.
+// flat_root: a selected MPI kernel flattens on the root, replicated: one keeps the whole matrix on every rank
+size_t matrix_peak_bytes(int n, int ranks, int rank, int mpi_kernels, int flat_root, int replicated);
+
+// Collective over MPI_COMM_WORLD: whether every node has the memory its ranks need
+int memory_fits(size_t bytes, int n);
+
+// Summary of the per-run samples of one benchmark entry
+typedef struct {
+    double mean;
+    double min;
+    double median;
+    double p90;
+    double p99;
+    double stddev;
+    double ci95;    // half-width of the 95% confidence interval of the mean
+} SampleStats;
+
+void compute_sample_stats(const double* samples, int count, SampleStats* stats);
+
+// bytes_moved gives the bandwidth columns, which are left empty when it is 0
+void benchmark_function(void (*func)(long double*), const char* func_name, double bytes_moved);
+
+// Same as benchmark_function, for entries run collectively by every rank of CURR_COMM
+void benchmark_mpi_function(void (*func)(long double*), const char* func_name, double bytes_moved);
+
+void load_input_wrapper(long double* time);
 
 void is_symmetric_sequential_wrapper(long double* time);
 
@@ -39,8 +71,46 @@ void transpose_omp_tasks_wrapper(long double* time);
 
 void transpose_cache_oblivious_wrapper(long double* time);
 
+void transpose_cache_oblivious_ws_wrapper(long double* time);
+
+void omp_plan_wrapper(long double* time);
+
+void transpose_inplace_wrapper(long double* time);
+
+void inplace_plan_wrapper(long double* time);
+
+void transpose_auto_wrapper(long double* time);
+
+void somatcopy_omp_wrapper(long double* time);
+
+void dense_to_packed_omp_wrapper(long double* time);
+
+void packed_to_dense_omp_wrapper(long double* time);
+
+void csr_transpose_omp_wrapper(long double* time);
+
+void csr_is_symmetric_omp_wrapper(long double* time);
+
+void csr_from_dense_omp_wrapper(long double* time);
+
+void symmetrize_omp_wrapper(long double* time);
+
+void somatadd_omp_wrapper(long double* time);
+
+void somatadd_unfused_omp_wrapper(long double* time);
+
 void is_symmetric_mpi_wrapper(long double* time);
 
+void check_symmetry_omp_wrapper(long double* time);
+
+void is_symmetric_tracked_wrapper(long double* time);
+
+void is_symmetric_tracked_full_wrapper(long double* time);
+
+void check_symmetry_mpi_wrapper(long double* time);
+
+void packed_scatter_gather_mpi_wrapper(long double* time);
+
 void transpose_mpi_wrapper(long double* time);
 
 void alltoall_transpose_mpi_wrapper(long double* time);
@@ -49,4 +119,8 @@ void block_cyclic_transpose_mpi_wrapper(long double* time);
 
 void nonblocking_transpose_mpi_wrapper(long double* time);
 
+void streaming_transpose_mpi_wrapper(long double* time);
+
+void mpi_plan_wrapper(long double* time);
+
 #endif // !UTILS_H
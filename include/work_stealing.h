@@ -0,0 +1,36 @@
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+// A rectangle of the matrix still to be transposed, packed into one word so that the
+// deque slots can be read and written atomically
+typedef uint64_t WSTask;
+
+#define WS_DEQUE_CAPACITY 256
+
+// Chase-Lev deque: the owner pushes and takes at the bottom, thieves steal at the top,
+// where the oldest and therefore largest subtrees are
+typedef struct {
+    atomic_long top;
+    char pad_top[64 - sizeof(atomic_long)];
+    atomic_long bottom;
+    char pad_bottom[64 - sizeof(atomic_long)];
+    _Atomic WSTask buffer[WS_DEQUE_CAPACITY];
+} WSDeque;
+
+// Returns 0 when the deque is full
+int ws_push(WSDeque* deque, WSTask task);
+
+// Owner side, returns 0 when the deque is empty
+int ws_take(WSDeque* deque, WSTask* task);
+
+// Thief side, returns 0 when the deque is empty or another thread won the race
+int ws_steal(WSDeque* deque, WSTask* task);
+
+// Cache-oblivious transpose whose quadrant recursion runs on a work-stealing pool of the
+// OpenMP threads instead of OpenMP tasks. Leaves are cfg->BLOCK_SIZE wide, like transpose_cache_oblivious.
+float** transpose_cache_oblivious_ws(float** matrix, int n, long double* time);
+
+#endif // !WORK_STEALING_H
@@ -1,10 +1,24 @@
 import os
+import sys
+import argparse
 import pandas as pd
 import numpy as np
 import matplotlib.pyplot as plt
 from matplotlib import cm
 from itertools import cycle
 
+def error_bars(frame):
+    """
+    Returns the 95% confidence half-widths of the given rows, or None for results written before
+    the benchmark recorded them.
+
+    Parameters:
+    - frame: A DataFrame holding a subset of the benchmark results.
+    """
+    if 'ci95' not in frame.columns:
+        return None
+    return frame['ci95'].fillna(0)
+
 def plot_speedup(df, output_dir):
     """
     Plots a 2D line plot comparing the speedup of each parallel function relative to the sequential function
@@ -64,6 +78,140 @@ def plot_speedup(df, output_dir):
     plt.savefig(os.path.join(output_dir, 'speedup_plot.png'), bbox_inches='tight')
     plt.close()
 
+def plot_bandwidth_efficiency(df, output_dir):
+    """
+    Plots a 2D line plot of the achieved bandwidth of each function as a percentage of the STREAM copy
+    peak measured at the same thread count, against the matrix size.
+
+    Parameters:
+    - df: A DataFrame containing the benchmark results.
+    - output_dir: Directory where the plot will be saved.
+    """
+    if 'pct_peak' not in df.columns or df['pct_peak'].isna().all():
+        print("No bandwidth data available. Skipping bandwidth efficiency plot.")
+        return
+
+    df_filtered = df.dropna(subset=['pct_peak'])
+
+    # Keep the best configuration of each function for every matrix size
+    idx = df_filtered.groupby(['matrix_dimension', 'func_name'])['pct_peak'].idxmax()
+    best = df_filtered.loc[idx].reset_index(drop=True)
+
+    # Define a color cycle with enough distinct colors using tab20 colormap
+    color_cycle = cycle(cm.tab20.colors)
+
+    plt.figure(figsize=(12, 8))
+
+    for func_name, group in best.groupby('func_name'):
+        color = next(color_cycle)
+        group_sorted = group.sort_values('matrix_dimension')
+        plt.plot(group_sorted['matrix_dimension'], group_sorted['pct_peak'],
+                 marker='o', label=func_name, color=color, linestyle='-')
+
+    plt.axhline(100, color='black', linestyle='--', linewidth=1, label='STREAM copy peak')
+    plt.xscale('log', base=2)
+    plt.xlabel('Matrix Dimension (log scale)')
+    plt.ylabel('Achieved Bandwidth (% of STREAM copy)')
+    plt.title('Bandwidth Efficiency of Each Function')
+    plt.legend()
+    plt.grid(True, which="both", ls="--", linewidth=0.5)
+
+    plt.xticks(ticks=sorted(best['matrix_dimension'].unique()),
+               labels=sorted(best['matrix_dimension'].unique()), rotation=45)
+
+    os.makedirs(output_dir, exist_ok=True)
+    plt.savefig(os.path.join(output_dir, 'bandwidth_efficiency_plot.png'), bbox_inches='tight')
+    plt.close()
+
+def plot_prefetch_benefit(df, output_dir):
+    """
+    Plots the speedup of every prefetching kernel over its run without prefetch (distance 0) against
+    the prefetch distance, for the largest matrix size of the results.
+
+    Parameters:
+    - df: A DataFrame containing the benchmark results.
+    - output_dir: Directory where the plot will be saved.
+    """
+    if 'prefetch_distance' not in df.columns or df['prefetch_distance'].nunique() < 2:
+        print("No prefetch distance sweep available. Skipping prefetch plot.")
+        return
+
+    swept = df.dropna(subset=['prefetch_distance'])
+    swept = swept[swept['matrix_dimension'] == swept['matrix_dimension'].max()]
+
+    # Best block size and thread count of each (function, distance), against the same at distance 0
+    best = swept.groupby(['func_name', 'prefetch_distance'])['time'].min().reset_index()
+    baseline = best[best['prefetch_distance'] == 0].set_index('func_name')['time']
+    best = best[best['func_name'].isin(baseline.index)]
+    if best.empty:
+        print("No run without prefetch to compare with. Skipping prefetch plot.")
+        return
+
+    color_cycle = cycle(cm.tab20.colors)
+
+    plt.figure(figsize=(12, 8))
+
+    for func_name, group in best.groupby('func_name'):
+        group_sorted = group.sort_values('prefetch_distance')
+        plt.plot(group_sorted['prefetch_distance'], baseline[func_name] / group_sorted['time'],
+                 marker='o', label=func_name, color=next(color_cycle), linestyle='-')
+
+    plt.axhline(1, color='black', linestyle='--', linewidth=1, label='no prefetch')
+    plt.xlabel('Prefetch Distance (rows)')
+    plt.ylabel('Speedup over Distance 0')
+    plt.title(f"Software Prefetch Benefit at Matrix Dimension {swept['matrix_dimension'].max()}")
+    plt.legend()
+    plt.grid(True, which="both", ls="--", linewidth=0.5)
+
+    os.makedirs(output_dir, exist_ok=True)
+    plt.savefig(os.path.join(output_dir, 'prefetch_benefit_plot.png'), bbox_inches='tight')
+    plt.close()
+
+def plot_sparse_density(df, output_dir):
+    """
+    Plots the time of every sparse kernel against the density of its matrix, for the largest matrix
+    size of the results, with the best dense transpose of that size as the break-even line.
+
+    Parameters:
+    - df: A DataFrame containing the benchmark results.
+    - output_dir: Directory where the plot will be saved.
+    """
+    if 'density' not in df.columns or df['density'].dropna().empty:
+        print("No sparse density sweep available. Skipping density plot.")
+        return
+
+    sparse = df.dropna(subset=['density'])
+    size = sparse['matrix_dimension'].max()
+    sparse = sparse[sparse['matrix_dimension'] == size]
+    best = sparse.groupby(['func_name', 'density'])['time'].min().reset_index()
+
+    color_cycle = cycle(cm.tab20.colors)
+
+    plt.figure(figsize=(12, 8))
+
+    for func_name, group in best.groupby('func_name'):
+        group_sorted = group.sort_values('density')
+        plt.plot(group_sorted['density'], group_sorted['time'], marker='o', label=func_name,
+                 color=next(color_cycle), linestyle='-')
+
+    dense = df[(df['matrix_dimension'] == size) & df['density'].isna() &
+               df['func_name'].str.startswith('transpose_omp')]
+    if not dense.empty:
+        plt.axhline(dense['time'].min(), color='black', linestyle='--', linewidth=1,
+                    label=f"best dense transpose ({dense.loc[dense['time'].idxmin(), 'func_name']})")
+
+    plt.xscale('log')
+    plt.yscale('log')
+    plt.xlabel('Density (stored entries / n²)')
+    plt.ylabel('Time (seconds)')
+    plt.title(f"Sparse Kernels against Density at Matrix Dimension {size}")
+    plt.legend()
+    plt.grid(True, which="both", ls="--", linewidth=0.5)
+
+    os.makedirs(output_dir, exist_ok=True)
+    plt.savefig(os.path.join(output_dir, 'sparse_density_plot.png'), bbox_inches='tight')
+    plt.close()
+
 def plot_strong_scaling(df, output_dir):
     """
     Plots strong scaling analysis showing how execution time decreases with increasing number of threads
@@ -116,8 +264,8 @@ def plot_strong_scaling(df, output_dir):
     for func_name, group in merged.groupby('func_name'):
         color = next(color_cycle)
         group_sorted = group.sort_values('threads')
-        plt.plot(group_sorted['threads'], group_sorted['time'],
-                 marker='o', label=func_name, color=color, linestyle='-')
+        plt.errorbar(group_sorted['threads'], group_sorted['time'], yerr=error_bars(group_sorted),
+                     marker='o', label=func_name, color=color, linestyle='-', capsize=3)
 
     plt.xscale('log', base=2)
     plt.yscale('log', base=10)
@@ -266,13 +414,13 @@ def plot_2d_execution_time(df, output_dir):
             print(f"No data available for function {func}. Skipping plot.")
             continue
 
-        # Aggregate data to avoid multiple points for the same matrix_dimension
-        aggregated = subset.groupby('matrix_dimension')['time'].min().reset_index()
+        # Keep the fastest configuration per matrix_dimension, along with its confidence interval
+        aggregated = subset.loc[subset.groupby('matrix_dimension')['time'].idxmin()].sort_values('matrix_dimension')
 
         plt.figure(figsize=(12, 8))
         color = next(color_cycle)
-        plt.plot(aggregated['matrix_dimension'], aggregated['time'],
-                 marker='o', label=func, color=color, linestyle='-')
+        plt.errorbar(aggregated['matrix_dimension'], aggregated['time'], yerr=error_bars(aggregated),
+                     marker='o', label=func, color=color, linestyle='-', capsize=3)
 
         plt.xscale('log', base=2)
         plt.yscale('log', base=10)
@@ -368,13 +516,13 @@ def plot_mpi_2d_execution_time(df, output_dir):
             print(f"No data available for MPI function {func}. Skipping plot.")
             continue
 
-        # Aggregate data to avoid multiple points for the same matrix_dimension
-        aggregated = subset.groupby('matrix_dimension')['time'].min().reset_index()
+        # Keep the fastest configuration per matrix_dimension, along with its confidence interval
+        aggregated = subset.loc[subset.groupby('matrix_dimension')['time'].idxmin()].sort_values('matrix_dimension')
 
         plt.figure(figsize=(12, 8))
         color = next(color_cycle)
-        plt.plot(aggregated['matrix_dimension'], aggregated['time'],
-                 marker='o', label=func, color=color, linestyle='-')
+        plt.errorbar(aggregated['matrix_dimension'], aggregated['time'], yerr=error_bars(aggregated),
+                     marker='o', label=func, color=color, linestyle='-', capsize=3)
 
         plt.xscale('log', base=2)
         plt.yscale('log', base=10)
@@ -456,12 +604,123 @@ def plot_additional_metrics(df, output_dir):
         plt.savefig(os.path.join(output_dir, f'{func}_efficiency.png'), bbox_inches='tight')
         plt.close()
 
+def read_results(path):
+    """
+    Reads a results file, skipping the '# key: value' metadata lines that per-run files start with.
+
+    Parameters:
+    - path: Path of benchmark_results.csv or of a file in the results directory.
+
+    Returns:
+    - The results as a DataFrame and the metadata as a dictionary (empty for files without it).
+    """
+    metadata = {}
+    with open(path) as f:
+        for line in f:
+            if not line.startswith('#'):
+                break
+            key, _, value = line[1:].partition(':')
+            metadata[key.strip()] = value.strip()
+
+    return pd.read_csv(path, comment='#'), metadata
+
+def compare_runs(base_path, new_path, threshold):
+    """
+    Lines up two result files by (func_name, matrix_dimension, threads, block_size) and reports the
+    entries that got slower by more than the threshold. A slowdown only counts as significant when
+    the 95% confidence intervals of the two means do not overlap, so noisy entries are not flagged.
+    A file recorded with fewer than 2 runs has no interval, so none of its entries can be significant.
+
+    Parameters:
+    - base_path: Results of the reference build.
+    - new_path: Results of the build under test.
+    - threshold: Smallest relative slowdown to report, in percent.
+
+    Returns:
+    - The number of significant regressions.
+    """
+    base, base_meta = read_results(base_path)
+    new, new_meta = read_results(new_path)
+
+    for key in sorted(set(base_meta) | set(new_meta)):
+        if key in ('date', 'command'):
+            continue
+        if base_meta.get(key) != new_meta.get(key):
+            print(f"{key}: {base_meta.get(key, '-')} -> {new_meta.get(key, '-')}")
+
+    keys = ['func_name', 'matrix_dimension', 'threads', 'block_size']
+
+    # Entries of a prefetch distance sweep only line up with the same distance
+    if 'prefetch_distance' in base.columns and 'prefetch_distance' in new.columns:
+        base['prefetch_distance'] = base['prefetch_distance'].fillna(-1)
+        new['prefetch_distance'] = new['prefetch_distance'].fillna(-1)
+        keys.append('prefetch_distance')
+    # Likewise for the density of the sparse entries
+    if 'density' in base.columns and 'density' in new.columns:
+        base['density'] = base['density'].fillna(-1)
+        new['density'] = new['density'].fillna(-1)
+        keys.append('density')
+    merged = pd.merge(base, new, on=keys, suffixes=('_base', '_new'))
+    if merged.empty:
+        print("The two runs have no (func_name, matrix_dimension, threads, block_size) entry in common.")
+        return 0
+
+    # Results written before the confidence intervals were recorded compare on the mean alone
+    for suffix in ('_base', '_new'):
+        if 'ci95' + suffix not in merged.columns:
+            merged['ci95' + suffix] = 0.0
+        merged['ci95' + suffix] = merged['ci95' + suffix].fillna(0)
+
+    # A single run writes a ci95 of 0, which would turn any jitter into a significant change
+    single_run = False
+    for path, meta in ((base_path, base_meta), (new_path, new_meta)):
+        if meta.get('runs', '').isdigit() and int(meta['runs']) < 2:
+            print(f"Warning: {path} was recorded with --runs {meta['runs']}, so it has no confidence "
+                  "interval and no change is counted as significant")
+            single_run = True
+
+    merged = merged[merged['time_base'] > 0]
+    merged['change_pct'] = 100.0 * (merged['time_new'] - merged['time_base']) / merged['time_base']
+    merged['significant'] = (merged['time_new'] - merged['ci95_new']) > (merged['time_base'] + merged['ci95_base'])
+    merged['improved'] = (merged['time_new'] + merged['ci95_new']) < (merged['time_base'] - merged['ci95_base'])
+    if single_run:
+        merged['significant'] = False
+        merged['improved'] = False
+
+    regressions = merged[(merged['change_pct'] > threshold) & merged['significant']].sort_values('change_pct', ascending=False)
+    improvements = merged[(merged['change_pct'] < -threshold) & merged['improved']]
+
+    print(f"Compared {len(merged)} entries, {len(regressions)} significant regression(s) "
+          f"and {len(improvements)} improvement(s) beyond {threshold:g}%")
+
+    for _, row in regressions.iterrows():
+        print(f"  SLOWER {row['func_name']} n={row['matrix_dimension']} threads={row['threads']} block={row['block_size']}: "
+              f"{row['time_base']:.3e} -> {row['time_new']:.3e} s ({row['change_pct']:+.1f}%)")
+
+    return len(regressions)
+
 def main():
+    parser = argparse.ArgumentParser(description='Plots benchmark results or compares two runs.')
+    parser.add_argument('--input', default='benchmark_results.csv', help='Results file to plot')
+    parser.add_argument('--compare', nargs=2, metavar=('BASE', 'NEW'),
+                        help='Compare two results files and exit with status 1 on significant slowdowns')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='Smallest slowdown in percent reported by --compare (default: 5)')
+    args = parser.parse_args()
+
+    if args.compare:
+        try:
+            regressions = compare_runs(args.compare[0], args.compare[1], args.threshold)
+        except FileNotFoundError as error:
+            print(f"The file '{error.filename}' was not found.")
+            sys.exit(2)
+        sys.exit(1 if regressions > 0 else 0)
+
     # Read the CSV file
     try:
-        df = pd.read_csv('benchmark_results.csv')
+        df, _ = read_results(args.input)
     except FileNotFoundError:
-        print("The file 'benchmark_results.csv' was not found.")
+        print(f"The file '{args.input}' was not found.")
         return
 
     # Replace zero runtime measurements with the smallest non-zero runtime to avoid plotting zeros
@@ -488,6 +747,9 @@ def main():
     # Plot Speedup
     plot_speedup(df, speedup_dir)
 
+    # Plot Bandwidth Efficiency next to the speedup
+    plot_bandwidth_efficiency(df, speedup_dir)
+
     # Plot 2D Execution Time for specific functions
     plot_2d_execution_time(df, execution_time_2d_dir)
 
@@ -503,6 +765,12 @@ def main():
     # Plot Additional Metrics (Efficiency)
     plot_additional_metrics(df, additional_metrics_dir)
 
+    # Plot the prefetch distance sweep, if there was one
+    plot_prefetch_benefit(df, additional_metrics_dir)
+
+    # Plot the sparse kernels against density, if any ran
+    plot_sparse_density(df, additional_metrics_dir)
+
     print("All plots have been generated and saved in the 'plots' directory.")
 
 if __name__ == "__main__":
@@ -0,0 +1,314 @@
+#define _GNU_SOURCE
+#include "../include/affinity.h"
+#include <dirent.h>
+#include <mpi.h>
+#include <omp.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PLACE_TEXT 64
+#define MAX_PLACEMENT_TEXT 8192
+
+typedef struct {
+    int cpu;
+    int package;
+    int core;
+    int node;
+} CpuInfo;
+
+static BindPolicy bind_policy = BIND_NONE;
+static CpuInfo* cpus = NULL;        // allowed CPUs in compact order
+static int num_cpus = 0;
+static int* cores = NULL;           // index in cpus of the first hardware thread of each core
+static int num_cores = 0;
+static int* nodes = NULL;           // NUMA node ids in use
+static int num_nodes = 0;
+static int local_rank = 0;
+static int local_size = 1;
+
+static char team_placement[MAX_PLACEMENT_TEXT] = "";
+static char* rank_places = NULL;    // MAX_PLACE_TEXT characters per world rank
+static int world_size = 1;
+static char rank_placement[MAX_PLACEMENT_TEXT] = "";
+
+const char* bind_policy_name(BindPolicy policy) {
+    switch (policy) {
+        case BIND_NONE: return "none";
+        case BIND_COMPACT: return "compact";
+        case BIND_SPREAD: return "spread";
+        case BIND_CORE: return "core";
+        case BIND_NUMA: return "numa";
+    }
+    return "unknown";
+}
+
+int bind_policy_parse(const char* name) {
+    for (int policy = BIND_NONE; policy <= BIND_NUMA; policy++) {
+        if (strcmp(name, bind_policy_name(policy)) == 0) {
+            return policy;
+        }
+    }
+    return -1;
+}
+
+static int read_int(const char* format, int cpu, int fallback) {
+    char path[256];
+    snprintf(path, sizeof(path), format, cpu);
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        return fallback;
+    }
+    int value;
+    if (fscanf(fp, "%d", &value) != 1) {
+        value = fallback;
+    }
+    fclose(fp);
+    return value;
+}
+
+// The NUMA node of a CPU is the nodeN entry of its sysfs directory, 0 without NUMA support
+static int numa_node_of(int cpu) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+
+    int node = 0;
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        return node;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+static int compare_cpus(const void* a, const void* b) {
+    const CpuInfo* x = a;
+    const CpuInfo* y = b;
+    if (x->node != y->node) return x->node - y->node;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->core != y->core) return x->core - y->core;
+    return x->cpu - y->cpu;
+}
+
+static void read_topology() {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        CPU_ZERO(&allowed);
+        CPU_SET(0, &allowed);
+    }
+
+    num_cpus = CPU_COUNT(&allowed);
+    cpus = malloc(num_cpus * sizeof(CpuInfo));
+    cores = malloc(num_cpus * sizeof(int));
+    nodes = malloc(num_cpus * sizeof(int));
+    if (cpus == NULL || cores == NULL || nodes == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the CPU topology.\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < num_cpus; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        cpus[count].cpu = cpu;
+        cpus[count].package = read_int("/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu, 0);
+        cpus[count].core = read_int("/sys/devices/system/cpu/cpu%d/topology/core_id", cpu, cpu);
+        cpus[count].node = numa_node_of(cpu);
+        count++;
+    }
+    num_cpus = count;
+
+    qsort(cpus, num_cpus, sizeof(CpuInfo), compare_cpus);
+
+    num_cores = 0;
+    num_nodes = 0;
+    for (int i = 0; i < num_cpus; i++) {
+        if (i == 0 || cpus[i].package != cpus[i - 1].package || cpus[i].core != cpus[i - 1].core) {
+            cores[num_cores++] = i;
+        }
+        if (i == 0 || cpus[i].node != cpus[i - 1].node) {
+            nodes[num_nodes++] = cpus[i].node;
+        }
+    }
+}
+
+// CPUs of place `index` out of `count` places under the current policy
+static void place_of(int index, int count, cpu_set_t* set) {
+    CPU_ZERO(set);
+
+    switch (bind_policy) {
+        case BIND_COMPACT:
+            CPU_SET(cpus[index % num_cpus].cpu, set);
+            break;
+        case BIND_CORE:
+            CPU_SET(cpus[cores[index % num_cores]].cpu, set);
+            break;
+        case BIND_SPREAD:
+            // Evenly spaced cores, or hardware threads once there are more places than cores
+            if (count <= num_cores) {
+                CPU_SET(cpus[cores[(long)index * num_cores / count]].cpu, set);
+            } else {
+                CPU_SET(cpus[((long)index * num_cpus / count) % num_cpus].cpu, set);
+            }
+            break;
+        case BIND_NUMA: {
+            int node = nodes[index % num_nodes];
+            for (int i = 0; i < num_cpus; i++) {
+                if (cpus[i].node == node) {
+                    CPU_SET(cpus[i].cpu, set);
+                }
+            }
+            break;
+        }
+        case BIND_NONE:
+            for (int i = 0; i < num_cpus; i++) {
+                CPU_SET(cpus[i].cpu, set);
+            }
+            break;
+    }
+}
+
+// Ranks on a node get equal, consecutive shares of the places of the policy: CPUs, cores or
+// NUMA domains. At least one each, so with more ranks than places the shares wrap around.
+static int places_per_rank() {
+    int places = bind_policy == BIND_COMPACT ? num_cpus : bind_policy == BIND_NUMA ? num_nodes : num_cores;
+    return places / local_size > 0 ? places / local_size : 1;
+}
+
+// CPUs of thread t of a team of `threads` on the local rank `rank`; thread 0 is where the main
+// thread of the rank was bound. Spread teams space their threads evenly over the share of the
+// rank, NUMA teams deal the domains of the share round-robin, and compact and core teams take
+// consecutive places from its start, only spilling into the next share when there are more
+// threads than places in it.
+static void team_place(int rank, int t, int threads, cpu_set_t* set) {
+    int share = places_per_rank();
+    if (bind_policy == BIND_SPREAD) {
+        place_of(rank * threads + t, local_size * threads, set);
+    } else if (bind_policy == BIND_NUMA) {
+        place_of(rank * share + t % share, local_size * threads, set);
+    } else {
+        place_of(rank * share + t, local_size * threads, set);
+    }
+}
+
+// Writes a set as a list of ranges such as 0-3+8, without commas so it fits in a CSV field
+static void format_set(const cpu_set_t* set, char* text, size_t size) {
+    size_t length = 0;
+    text[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE && length < size; cpu++) {
+        if (!CPU_ISSET(cpu, set)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)) {
+            last++;
+        }
+        if (last > cpu) {
+            length += snprintf(text + length, size - length, length == 0 ? "%d-%d" : "+%d-%d", cpu, last);
+        } else {
+            length += snprintf(text + length, size - length, length == 0 ? "%d" : "+%d", cpu);
+        }
+        cpu = last;
+    }
+}
+
+void affinity_init(BindPolicy policy) {
+    bind_policy = policy;
+    read_topology();
+
+    int world_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    // Ranks on the same node share its CPUs, so they are placed by their rank within the node
+    MPI_Comm node_comm;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, world_rank, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &local_rank);
+    MPI_Comm_size(node_comm, &local_size);
+    MPI_Comm_free(&node_comm);
+
+    cpu_set_t set;
+    team_place(local_rank, 0, 1, &set);
+    if (policy != BIND_NONE && sched_setaffinity(0, sizeof(set), &set) != 0) {
+        fprintf(stderr, "Warning: rank %d could not be bound with policy %s\n", world_rank, bind_policy_name(policy));
+    }
+
+    char place[MAX_PLACE_TEXT];
+    format_set(&set, place, sizeof(place));
+
+    if (world_rank == 0) {
+        rank_places = malloc((size_t)world_size * MAX_PLACE_TEXT);
+        if (rank_places == NULL) {
+            fprintf(stderr, "Failed to allocate memory for the rank placement.\n");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    MPI_Gather(place, MAX_PLACE_TEXT, MPI_CHAR, rank_places, MAX_PLACE_TEXT, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if (world_rank == 0 && policy != BIND_NONE) {
+        printf("Binding policy %s over %d CPUs (%d cores, %d NUMA domains), rank placement: %s\n", bind_policy_name(policy),
+               num_cpus, num_cores, num_nodes, affinity_rank_placement(world_size));
+    }
+}
+
+void affinity_bind_team(int threads) {
+    if (bind_policy == BIND_NONE) {
+        team_placement[0] = '\0';
+        return;
+    }
+
+    char places[MAX_PLACEMENT_TEXT];
+    size_t length = 0;
+
+    // Each thread binds itself, OpenMP keeps the same threads for later regions of this size.
+    // The team stays in the share of its rank, off the CPUs of the others waiting in a barrier.
+    char* thread_places = malloc((size_t)threads * MAX_PLACE_TEXT);
+    if (thread_places == NULL) {
+        fprintf(stderr, "Failed to allocate memory for the thread placement.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int t = omp_get_thread_num();
+        cpu_set_t set;
+        team_place(local_rank, t, omp_get_num_threads(), &set);
+        sched_setaffinity(0, sizeof(set), &set);
+        format_set(&set, &thread_places[t * MAX_PLACE_TEXT], MAX_PLACE_TEXT);
+    }
+
+    places[0] = '\0';
+    for (int t = 0; t < threads && length < sizeof(places); t++) {
+        length += snprintf(places + length, sizeof(places) - length, t == 0 ? "%s" : ";%s", &thread_places[t * MAX_PLACE_TEXT]);
+    }
+    free(thread_places);
+
+    snprintf(team_placement, sizeof(team_placement), "%s", places);
+    printf("Threads bound (%s): %s\n", bind_policy_name(bind_policy), team_placement);
+}
+
+const char* affinity_team_placement() {
+    return team_placement;
+}
+
+const char* affinity_rank_placement(int ranks) {
+    size_t length = 0;
+    rank_placement[0] = '\0';
+    if (bind_policy == BIND_NONE) {
+        return rank_placement;
+    }
+    for (int r = 0; rank_places != NULL && r < ranks && r < world_size && length < sizeof(rank_placement); r++) {
+        length += snprintf(rank_placement + length, sizeof(rank_placement) - length, r == 0 ? "%s" : ";%s",
+                           &rank_places[r * MAX_PLACE_TEXT]);
+    }
+    return rank_placement;
+}
@@ -0,0 +1,343 @@
+#include "../include/autotune.h"
+#include "../include/config.h"
+#include "../include/utils.h"
+#include "../include/omp_parallel.h"
+#include "../include/implicit_parallel.h"
+#include "../include/work_stealing.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_WISDOM_ENTRIES 1024
+#define MIN_TUNE_BLOCK 8
+#define MAX_TUNE_BLOCK 256
+
+typedef struct {
+    const char* name;
+    int uses_block_size;
+    float** (*run)(float** matrix, int n, int block_size, long double* time);
+} AutotuneCandidate;
+
+typedef struct {
+    int candidate;
+    int block_size;
+    double score;
+} AutotuneTrial;
+
+static WisdomEntry wisdom[MAX_WISDOM_ENTRIES];
+static int wisdom_count = 0;
+static int wisdom_loaded = 0;
+
+// Some kernels read the block size from the config, so it is swapped in for the call
+static float** with_config_block(float** (*kernel)(float**, int, long double*), float** matrix, int n, int block_size, long double* time) {
+    Config* cfg = get_config();
+    int saved = cfg->BLOCK_SIZE;
+    cfg->BLOCK_SIZE = block_size;
+    float** result = kernel(matrix, n, time);
+    cfg->BLOCK_SIZE = saved;
+    return result;
+}
+
+static float** run_omp(float** matrix, int n, int block_size, long double* time) {
+    (void)block_size;
+    return transpose_omp(matrix, n, time);
+}
+
+static float** run_omp_cache_oblivious(float** matrix, int n, int block_size, long double* time) {
+    return with_config_block(transpose_cache_oblivious, matrix, n, block_size, time);
+}
+
+static float** run_omp_cache_oblivious_ws(float** matrix, int n, int block_size, long double* time) {
+    return with_config_block(transpose_cache_oblivious_ws, matrix, n, block_size, time);
+}
+
+static float** run_implicit(float** matrix, int n, int block_size, long double* time) {
+    (void)block_size;
+    return transpose_implicit(matrix, n, time);
+}
+
+static float** run_implicit_block_based(float** matrix, int n, int block_size, long double* time) {
+    return with_config_block(transpose_implicit_block_based, matrix, n, block_size, time);
+}
+
+static float** run_implicit_cache_oblivious(float** matrix, int n, int block_size, long double* time) {
+    return with_config_block(transpose_implicit_cache_oblivious, matrix, n, block_size, time);
+}
+
+static const AutotuneCandidate candidates[] = {
+    {"transpose_omp", 0, run_omp},
+    {"transpose_omp_block_based", 1, transpose_omp_block_based},
+    {"transpose_omp_tile_distributed", 1, transpose_omp_tile_distributed},
+    {"transpose_omp_tasks", 1, transpose_omp_tasks},
+    {"transpose_cache_oblivious", 1, run_omp_cache_oblivious},
+    {"transpose_cache_oblivious_ws", 1, run_omp_cache_oblivious_ws},
+    {"transpose_implicit", 0, run_implicit},
+    {"transpose_implicit_block_based", 1, run_implicit_block_based},
+    {"transpose_implicit_cache_oblivious", 1, run_implicit_cache_oblivious},
+};
+
+static const int num_candidates = sizeof(candidates) / sizeof(candidates[0]);
+
+static const AutotuneCandidate* find_candidate(const char* name) {
+    for (int i = 0; i < num_candidates; i++) {
+        if (strcmp(candidates[i].name, name) == 0) {
+            return &candidates[i];
+        }
+    }
+    return NULL;
+}
+
+const char* autotune_cpu_model() {
+    static char model[128] = "";
+    if (model[0] != '\0') {
+        return model;
+    }
+
+    strcpy(model, "unknown");
+    FILE* fp = fopen("/proc/cpuinfo", "r");
+    if (fp == NULL) {
+        return model;
+    }
+
+    char line[512];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (strncmp(line, "model name", 10) == 0) {
+            char* value = strchr(line, ':');
+            if (value != NULL) {
+                value++;
+                while (*value == ' ' || *value == '\t') {
+                    value++;
+                }
+                value[strcspn(value, "\t\n")] = '\0';
+                snprintf(model, sizeof(model), "%s", value);
+            }
+            break;
+        }
+    }
+
+    fclose(fp);
+    return model;
+}
+
+int wisdom_load(const char* path) {
+    wisdom_count = 0;
+    wisdom_loaded = 1;
+
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        return 0;
+    }
+
+    // cpu_model \t n \t threads \t kernel \t block_size \t seconds
+    char line[512];
+    while (fgets(line, sizeof(line), fp) != NULL && wisdom_count < MAX_WISDOM_ENTRIES) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        WisdomEntry entry;
+        char* fields[6];
+        int count = 0;
+        char* save = NULL;
+        for (char* token = strtok_r(line, "\t\n", &save); token != NULL && count < 6; token = strtok_r(NULL, "\t\n", &save)) {
+            fields[count++] = token;
+        }
+        if (count != 6 || find_candidate(fields[3]) == NULL) {
+            continue;
+        }
+
+        snprintf(entry.cpu_model, sizeof(entry.cpu_model), "%s", fields[0]);
+        entry.n = atoi(fields[1]);
+        entry.threads = atoi(fields[2]);
+        snprintf(entry.kernel, sizeof(entry.kernel), "%s", fields[3]);
+        entry.block_size = atoi(fields[4]);
+        entry.seconds = atof(fields[5]);
+        wisdom[wisdom_count++] = entry;
+    }
+
+    fclose(fp);
+    return wisdom_count;
+}
+
+static int wisdom_save(const char* path) {
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* fp = fopen(tmp_path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open wisdom file %s for writing\n", tmp_path);
+        return 0;
+    }
+
+    fprintf(fp, "# cpu_model\tn\tthreads\tkernel\tblock_size\tseconds\n");
+    for (int i = 0; i < wisdom_count; i++) {
+        fprintf(fp, "%s\t%d\t%d\t%s\t%d\t%.9e\n", wisdom[i].cpu_model, wisdom[i].n, wisdom[i].threads,
+                wisdom[i].kernel, wisdom[i].block_size, wisdom[i].seconds);
+    }
+    fclose(fp);
+
+    // Rename so that a concurrent reader never sees a half written file
+    if (rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Failed to replace wisdom file %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+const WisdomEntry* wisdom_lookup(int n, int threads) {
+    if (!wisdom_loaded) {
+        wisdom_load(get_config()->WISDOM_PATH);
+    }
+
+    const char* model = autotune_cpu_model();
+    const WisdomEntry* best = NULL;
+    double best_distance = 0;
+
+    for (int i = 0; i < wisdom_count; i++) {
+        if (wisdom[i].threads != threads || strcmp(wisdom[i].cpu_model, model) != 0) {
+            continue;
+        }
+
+        // Sizes are compared by ratio, so 1024 is as close to 512 as it is to 2048
+        double distance = wisdom[i].n > n ? (double)wisdom[i].n / n : (double)n / wisdom[i].n;
+        if (best == NULL || distance < best_distance) {
+            best = &wisdom[i];
+            best_distance = distance;
+        }
+    }
+
+    return best;
+}
+
+static float** random_matrix(int n) {
+    float** matrix = allocate_matrix(n);
+    unsigned int seed = 42;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            matrix[i][j] = (float)(rand_r(&seed) % (int)10e6) / 1000;
+        }
+    }
+    return matrix;
+}
+
+// Wall time of the whole call, since that is what a caller of transpose_auto pays
+static double time_trial(const AutotuneTrial* trial, float** matrix, int n, int runs) {
+    double best = -1;
+    for (int r = 0; r < runs; r++) {
+        long double kernel_time;
+        double start = get_time_in_seconds();
+        float** result = candidates[trial->candidate].run(matrix, n, trial->block_size, &kernel_time);
+        double elapsed = get_time_in_seconds() - start;
+        deallocate_matrix(result, n);
+
+        if (best < 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+static int compare_trials(const void* a, const void* b) {
+    double sa = ((const AutotuneTrial*)a)->score;
+    double sb = ((const AutotuneTrial*)b)->score;
+    return (sa > sb) - (sa < sb);
+}
+
+const WisdomEntry* autotune(int n, int threads, const char* wisdom_path) {
+    Config* cfg = get_config();
+
+    // Tiles that do not fit in L2 alongside their transpose are not worth timing
+    long l2_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2_size <= 0) {
+        l2_size = 1 << 20;
+    }
+
+    AutotuneTrial trials[64];
+    int num_trials = 0;
+    for (int c = 0; c < num_candidates; c++) {
+        if (!candidates[c].uses_block_size) {
+            trials[num_trials++] = (AutotuneTrial){c, 0, 0};
+            continue;
+        }
+        for (int block_size = MIN_TUNE_BLOCK; block_size <= MAX_TUNE_BLOCK && block_size <= n; block_size *= 2) {
+            if (2L * block_size * block_size * (long)sizeof(float) > l2_size) {
+                break;
+            }
+            trials[num_trials++] = (AutotuneTrial){c, block_size, 0};
+        }
+    }
+
+    omp_set_num_threads(threads);
+    float** matrix = random_matrix(n);
+
+    // Warm up the thread pool and the pages of the source matrix
+    long double warmup_time;
+    deallocate_matrix(transpose_omp(matrix, n, &warmup_time), n);
+
+    // Successive halving: every round doubles the runs and keeps the faster half
+    int runs = 1;
+    while (num_trials > 1) {
+        for (int t = 0; t < num_trials; t++) {
+            trials[t].score = time_trial(&trials[t], matrix, n, runs);
+        }
+        qsort(trials, num_trials, sizeof(AutotuneTrial), compare_trials);
+
+        if (cfg->VERBOSE_LEVEL > 0) {
+            printf("Autotune n=%d threads=%d: %d candidates with %d run(s), leader %s (block %d) %.9f s\n", n, threads,
+                   num_trials, runs, candidates[trials[0].candidate].name, trials[0].block_size, trials[0].score);
+        }
+
+        num_trials = (num_trials + 1) / 2;
+        runs *= 2;
+    }
+
+    deallocate_matrix(matrix, n);
+
+    if (!wisdom_loaded) {
+        wisdom_load(wisdom_path);
+    }
+
+    WisdomEntry entry;
+    snprintf(entry.cpu_model, sizeof(entry.cpu_model), "%s", autotune_cpu_model());
+    entry.n = n;
+    entry.threads = threads;
+    snprintf(entry.kernel, sizeof(entry.kernel), "%s", candidates[trials[0].candidate].name);
+    entry.block_size = trials[0].block_size;
+    entry.seconds = trials[0].score;
+
+    // Replace the previous winner for the same key, if any
+    int slot = wisdom_count;
+    for (int i = 0; i < wisdom_count; i++) {
+        if (wisdom[i].n == n && wisdom[i].threads == threads && strcmp(wisdom[i].cpu_model, entry.cpu_model) == 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == MAX_WISDOM_ENTRIES) {
+        fprintf(stderr, "Wisdom is full, the result for n=%d threads=%d is not stored\n", n, threads);
+        return NULL;
+    }
+    wisdom[slot] = entry;
+    if (slot == wisdom_count) {
+        wisdom_count++;
+    }
+
+    wisdom_save(wisdom_path);
+
+    printf("Autotuned n=%d threads=%d: %s (block %d) in %.9f seconds\n", n, threads, entry.kernel, entry.block_size, entry.seconds);
+
+    return &wisdom[slot];
+}
+
+float** transpose_auto(float** matrix, int n, long double* time) {
+    const WisdomEntry* entry = wisdom_lookup(n, omp_get_max_threads());
+    const AutotuneCandidate* candidate = entry != NULL ? find_candidate(entry->kernel) : NULL;
+
+    if (candidate == NULL) {
+        return transpose_omp(matrix, n, time);
+    }
+
+    return candidate->run(matrix, n, entry->block_size, time);
+}
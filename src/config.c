@@ -1,4 +1,8 @@
 #include "../include/config.h"
+#include "../include/results.h"
+#include "../include/affinity.h"
+#include "../include/kernels.h"
+#include "../include/symmetry.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -35,6 +39,28 @@ void parse_range(const char *arg, int *mn, int *mx) {
     }
 }
 
+// Comma separated densities in (0, 1], returns how many were read or 0 when malformed
+static int parse_densities(const char* arg, double* densities) {
+    int count = 0;
+    const char* p = arg;
+    while (count < MAX_SPARSE_DENSITIES) {
+        char* end;
+        double density = strtod(p, &end);
+        if (end == p || !(density > 0 && density <= 1)) {
+            return 0;
+        }
+        densities[count++] = density;
+        if (*end == '\0') {
+            return count;
+        }
+        if (*end != ',') {
+            return 0;
+        }
+        p = end + 1;
+    }
+    return 0;
+}
+
 // Initializes the configuration, possibly from a file
 void init_config(int argc, char *argv[]) {
     // Default values
@@ -43,8 +69,26 @@ void init_config(int argc, char *argv[]) {
     int VERBOSE_LEVEL = 0;
     int BLOCK_SIZE = 4;
     int NUM_RUNS = 1;
+    int WARMUP_RUNS = 0;
     int BENCHMARK_FULL = 0;
     int OMP_THREADS = 4;
+    int AUTOTUNE = 0;
+    int PERF_COUNTERS = 0;
+    int STREAM_BASELINE = 1;
+    int THREAD_STATS = 0;
+    int BIND_POLICY = BIND_NONE;
+    int MPI_STAGING_MB = 64;
+    SymmetryTolerance SYMMETRY = {SYMMETRY_ABS, 0.0};
+    int MIN_PREFETCH_DISTANCE = 0;
+    int MAX_PREFETCH_DISTANCE = 0;
+    double SPARSE_DENSITIES[MAX_SPARSE_DENSITIES] = {0.001, 0.01};
+    int NUM_SPARSE_DENSITIES = 2;
+    const char* WISDOM_PATH = "transpose_wisdom.txt";
+    const char* RESULTS_DIR = "results";
+    const char* INPUT_PATH = NULL;
+    const char* KERNEL_FILTER = NULL;
+    const char* KERNEL_EXCLUDE = NULL;
+    int LIST_KERNELS = 0;
 
     int MIN_MATRIX_DIMENSION = MATRIX_DIMENSION;
     int MAX_MATRIX_DIMENSION = MATRIX_DIMENSION;
@@ -61,14 +105,32 @@ void init_config(int argc, char *argv[]) {
             printf("  --help                     Print this message\n");
             printf("  --verbose <int>            Set the verbose level (default: 0)\n");
             printf("  --runs <int>               Set the number of runs (default: 1)\n");
+            printf("  --warmup <int>             Set the number of discarded warm-up runs, each costing one more call per entry (default: 0)\n");
             printf("  --benchmark-full           Benchmark full ranges (ranges options will be disabled)\n");
+            printf("  --no-stream                Skip the STREAM bandwidth calibration (no percent of peak in the results)\n");
+            printf("  --perf-counters            Record hardware performance counters per entry (needs perf_event_open access)\n");
+            printf("  --bind <policy>            Pin threads and ranks: none, compact, spread, core or numa (default: none)\n");
+            printf("  --mpi-staging-mb <int>     Root staging buffer of streaming_transpose_mpi in MiB (default: 64)\n");
+            printf("  --symmetry-tolerance <m:v> Tolerance of the check_symmetry entries, m is abs, rel or ulp (default: abs:0)\n");
+            printf("  --density <list>           Comma separated densities of the sparse entries, in (0, 1] (default: 0.001,0.01)\n");
+            printf("  --thread-stats             Record per-thread busy and idle time of the OpenMP kernels (imbalance columns)\n");
+            printf("  --thread-stats-dump        Same as --thread-stats, also writing every thread to benchmark_threads.csv\n");
+            printf("  --autotune                 Tune the kernel and block size for every (size, threads) and store the winners\n");
+            printf("  --input <path>             Benchmark a MatrixMarket (.mtx) or NumPy (.npy) square matrix instead of random ones,\n");
+            printf("                             its dimension replaces --matrix-dimension\n");
+            printf("  --results-dir <path>       Directory of the per-run results files with metadata (default: results)\n");
+            printf("  --wisdom <path>            Wisdom file used by --autotune and transpose_auto (default: transpose_wisdom.txt)\n");
+            printf("  --kernels <list>           Only run these kernels: comma separated name globs or families (default: all)\n");
+            printf("  --exclude <list>           Skip these kernels: comma separated name globs or families\n");
+            printf("  --list-kernels             Print the kernel registry with the parameters each kernel varies with\n");
             printf("\n");
             printf("Range options (must be expressed in powers of two):\n");
             printf("  --matrix-dimension <int|int-int>   Set the matrix dimension (default: 1024) (full: 2^4 - 2^12)\n");
             printf("  --block-size <int|int-int>         Set the block size (default: 4) (full: 2^2 - 2^8)\n");
             printf("  --threads <int|int-int>            Set the number of threads (default: 4) (full: 2^1 - 2^3)\n");
+            printf("  --prefetch-distance <int|int-int>  Prefetch this many rows ahead in the tiled and MPI local transposes (default: 0, off)\n");
             printf("\n");
-            printf("WARNING: Running with matrix-dimension larger than the full range is not allowed due to project specifications\n");
+            printf("WARNING: Running with matrix-dimension larger than the full range is outside the project specifications: sizes that do not fit in memory are skipped\n");
             printf("         Running with block-size larger than the full range does not make much sense as the value should be optimized to the cache size\n");
             printf("         Running with threads larger than the full range is only recommended when running on a computing cluster\n");
             exit(0);
@@ -77,8 +139,9 @@ void init_config(int argc, char *argv[]) {
                 parse_range(argv[i + 1], &MIN_MATRIX_DIMENSION, &MAX_MATRIX_DIMENSION);
                 MATRIX_DIMENSION = MIN_MATRIX_DIMENSION;
 
-                if (MATRIX_DIMENSION < 16 || MAX_MATRIX_DIMENSION > 4096) {
-                    fprintf(stderr, "Error: Matrix dimension must be between 16 and 4096\n");
+                // Whether a size fits in memory is checked before allocating it
+                if (MATRIX_DIMENSION < 16 || MAX_MATRIX_DIMENSION > 1 << 30) {
+                    fprintf(stderr, "Error: Matrix dimension must be between 16 and 2^30\n");
                     exit(1);
                 }
 
@@ -127,8 +190,133 @@ void init_config(int argc, char *argv[]) {
                 fprintf(stderr, "Error: --runs flag requires an argument\n");
                 exit(1);
             }
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            if (i + 1 < argc) {
+                WARMUP_RUNS = atoi(argv[i + 1]);
+                if (WARMUP_RUNS < 0) {
+                    fprintf(stderr, "Error: Number of warm-up runs must not be negative\n");
+                    exit(1);
+                }
+                i++;
+            } else {
+                fprintf(stderr, "Error: --warmup flag requires an argument\n");
+                exit(1);
+            }
         } else if (strcmp(argv[i], "--benchmark-full") == 0) {
             BENCHMARK_FULL = 1;
+        } else if (strcmp(argv[i], "--no-stream") == 0) {
+            STREAM_BASELINE = 0;
+        } else if (strcmp(argv[i], "--perf-counters") == 0) {
+            PERF_COUNTERS = 1;
+        } else if (strcmp(argv[i], "--bind") == 0) {
+            if (i + 1 < argc) {
+                BIND_POLICY = bind_policy_parse(argv[i + 1]);
+                if (BIND_POLICY < 0) {
+                    fprintf(stderr, "Error: Unknown binding policy '%s' (none, compact, spread, core or numa)\n", argv[i + 1]);
+                    exit(1);
+                }
+                i++;
+            } else {
+                fprintf(stderr, "Error: --bind flag requires an argument\n");
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--prefetch-distance") == 0) {
+            if (i + 1 < argc) {
+                parse_range(argv[i + 1], &MIN_PREFETCH_DISTANCE, &MAX_PREFETCH_DISTANCE);
+                if (MIN_PREFETCH_DISTANCE < 0) {
+                    fprintf(stderr, "Error: Prefetch distance must not be negative\n");
+                    exit(1);
+                }
+                i++;
+            } else {
+                fprintf(stderr, "Error: --prefetch-distance flag requires an argument\n");
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--density") == 0) {
+            if (i + 1 < argc) {
+                NUM_SPARSE_DENSITIES = parse_densities(argv[i + 1], SPARSE_DENSITIES);
+                if (NUM_SPARSE_DENSITIES == 0) {
+                    fprintf(stderr, "Error: Invalid density list '%s' (at most %d values in (0, 1])\n", argv[i + 1], MAX_SPARSE_DENSITIES);
+                    exit(1);
+                }
+                i++;
+            } else {
+                fprintf(stderr, "Error: --density flag requires an argument\n");
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--symmetry-tolerance") == 0) {
+            if (i + 1 < argc) {
+                if (!symmetry_tolerance_parse(argv[i + 1], &SYMMETRY)) {
+                    fprintf(stderr, "Error: Invalid symmetry tolerance '%s' (abs:<v>, rel:<v> or ulp:<v>, v >= 0)\n", argv[i + 1]);
+                    exit(1);
+                }
+                i++;
+            } else {
+                fprintf(stderr, "Error: --symmetry-tolerance flag requires an argument\n");
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--mpi-staging-mb") == 0) {
+            if (i + 1 < argc) {
+                MPI_STAGING_MB = atoi(argv[i + 1]);
+                if (MPI_STAGING_MB <= 0) {
+                    fprintf(stderr, "Error: The staging buffer must be at least 1 MiB\n");
+                    exit(1);
+                }
+                i++;
+            } else {
+                fprintf(stderr, "Error: --mpi-staging-mb flag requires an argument\n");
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--thread-stats") == 0) {
+            THREAD_STATS = THREAD_STATS > 1 ? THREAD_STATS : 1;
+        } else if (strcmp(argv[i], "--thread-stats-dump") == 0) {
+            THREAD_STATS = 2;
+        } else if (strcmp(argv[i], "--autotune") == 0) {
+            AUTOTUNE = 1;
+        } else if (strcmp(argv[i], "--input") == 0) {
+            if (i + 1 < argc) {
+                INPUT_PATH = argv[i + 1];
+                i++;
+            } else {
+                fprintf(stderr, "Error: --input flag requires an argument\n");
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--results-dir") == 0) {
+            if (i + 1 < argc) {
+                RESULTS_DIR = argv[i + 1];
+                i++;
+            } else {
+                fprintf(stderr, "Error: --results-dir flag requires an argument\n");
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--wisdom") == 0) {
+            if (i + 1 < argc) {
+                WISDOM_PATH = argv[i + 1];
+                i++;
+            } else {
+                fprintf(stderr, "Error: --wisdom flag requires an argument\n");
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--kernels") == 0 || strcmp(argv[i], "--exclude") == 0) {
+            if (i + 1 < argc) {
+                const char* unknown;
+                int unknown_len;
+                if (!kernel_patterns_valid(argv[i + 1], &unknown, &unknown_len)) {
+                    fprintf(stderr, "Error: '%.*s' matches no kernel or family (see --list-kernels)\n", unknown_len, unknown);
+                    exit(1);
+                }
+                if (strcmp(argv[i], "--kernels") == 0) {
+                    KERNEL_FILTER = argv[i + 1];
+                } else {
+                    KERNEL_EXCLUDE = argv[i + 1];
+                }
+                i++;
+            } else {
+                fprintf(stderr, "Error: %s flag requires an argument\n", argv[i]);
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--list-kernels") == 0) {
+            LIST_KERNELS = 1;
         } else if (strcmp(argv[i], "--threads") == 0) {
             if (i + 1 < argc) {
                 parse_range(argv[i + 1], &MIN_OMP_THREADS, &MAX_OMP_THREADS);
@@ -149,12 +337,37 @@ void init_config(int argc, char *argv[]) {
         }
     }
 
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (LIST_KERNELS) {
+        if (rank == 0) {
+            kernel_list(stdout);
+        }
+        MPI_Finalize();
+        exit(0);
+    }
+
     FILE *fp = fopen("benchmark_results.csv", "w");
     if (fp != NULL) {
-        fprintf(fp, "matrix_dimension,threads,block_size,time,func_name\n");
+        write_results_header(fp);
         fclose(fp);
     }
 
+    fp = fopen("benchmark_samples.csv", "w");
+    if (fp != NULL) {
+        fprintf(fp, "matrix_dimension,threads,block_size,func_name,run,time,call_time\n");
+        fclose(fp);
+    }
+
+    if (THREAD_STATS > 1) {
+        fp = fopen("benchmark_threads.csv", "w");
+        if (fp != NULL) {
+            fprintf(fp, "matrix_dimension,threads,block_size,func_name,thread,busy,idle,items\n");
+            fclose(fp);
+        }
+    }
+
     // Set the configuration
     config.CURR_RUN = CURR_RUN;
     config.MIN_MATRIX_DIMENSION = MIN_MATRIX_DIMENSION;
@@ -165,10 +378,31 @@ void init_config(int argc, char *argv[]) {
     config.MAX_BLOCK_SIZE = MAX_BLOCK_SIZE;
     config.BLOCK_SIZE = BLOCK_SIZE;
     config.NUM_RUNS = NUM_RUNS;
+    config.WARMUP_RUNS = WARMUP_RUNS;
     config.BENCHMARK_FULL = BENCHMARK_FULL;
     config.MIN_OMP_THREADS = MIN_OMP_THREADS;
     config.MAX_OMP_THREADS = MAX_OMP_THREADS;
     config.OMP_THREADS = OMP_THREADS;
+    config.AUTOTUNE = AUTOTUNE;
+    config.PERF_COUNTERS = PERF_COUNTERS;
+    config.STREAM_BASELINE = STREAM_BASELINE;
+    config.THREAD_STATS = THREAD_STATS;
+    config.BIND_POLICY = BIND_POLICY;
+    config.MPI_STAGING_MB = MPI_STAGING_MB;
+    config.SYMMETRY_MODE = SYMMETRY.mode;
+    config.SYMMETRY_TOLERANCE = SYMMETRY.tolerance;
+    config.MIN_PREFETCH_DISTANCE = MIN_PREFETCH_DISTANCE;
+    config.MAX_PREFETCH_DISTANCE = MAX_PREFETCH_DISTANCE;
+    config.PREFETCH_DISTANCE = MIN_PREFETCH_DISTANCE;
+    memcpy(config.SPARSE_DENSITIES, SPARSE_DENSITIES, sizeof(SPARSE_DENSITIES));
+    config.NUM_SPARSE_DENSITIES = NUM_SPARSE_DENSITIES;
+    config.SPARSE_DENSITY = -1;
+    config.WISDOM_PATH = WISDOM_PATH;
+    config.RESULTS_FILE = NULL;
+    config.KERNEL_FILTER = KERNEL_FILTER;
+    config.INPUT_PATH = INPUT_PATH;
+    config.INPUT_BYTES = 0;
+    config.KERNEL_EXCLUDE = KERNEL_EXCLUDE;
 
     if (config.BENCHMARK_FULL == 1) {
         printf("### Benchmarking full ranges ###\n");
@@ -182,6 +416,14 @@ void init_config(int argc, char *argv[]) {
         config.MIN_OMP_THREADS = 1;
         config.MAX_OMP_THREADS = 64;
     }
+
+    // benchmark_results.csv always holds the latest run, every run also keeps a file of its own
+    if (rank == 0) {
+        config.RESULTS_FILE = create_run_results(RESULTS_DIR, argc, argv);
+        if (config.RESULTS_FILE != NULL) {
+            printf("Results of this run are written to %s\n", config.RESULTS_FILE);
+        }
+    }
 }
 
 Config* get_config() {
@@ -0,0 +1,184 @@
+#include "../include/fused.h"
+#include "../include/config.h"
+#include "../include/omp_parallel.h"
+#include "../include/perf_counters.h"
+#include "../include/utils.h"
+#include "../include/thread_stats.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int parse_trans(char trans, const char* caller) {
+    if (trans == 'N' || trans == 'n') {
+        return 0;
+    }
+    if (trans == 'T' || trans == 't') {
+        return 1;
+    }
+    fprintf(stderr, "%s: unsupported trans '%c' (N or T)\n", caller, trans);
+    exit(EXIT_FAILURE);
+}
+
+// One output tile. The rows of the output are contiguous, so the inner loops vectorise on
+// the write side whatever the operands are read as.
+static void scale_tile(int ta, float alpha, float** a, float** b, int i, int j, int max_i, int max_j) {
+    for (int ii = i; ii < max_i; ii++) {
+        float* restrict row = b[ii];
+        if (ta) {
+            #pragma omp simd
+            for (int jj = j; jj < max_j; jj++) {
+                row[jj] = alpha * a[jj][ii];
+            }
+        } else {
+            const float* restrict source = a[ii];
+            #pragma omp simd
+            for (int jj = j; jj < max_j; jj++) {
+                row[jj] = alpha * source[jj];
+            }
+        }
+    }
+}
+
+// c may alias b when tb is 0: every element of b is read before the same element of c is written
+static void add_tile(int ta, int tb, float alpha, float** a, float beta, float** b, float** c,
+                     int i, int j, int max_i, int max_j) {
+    for (int ii = i; ii < max_i; ii++) {
+        float* row = c[ii];
+        if (ta && tb) {
+            #pragma omp simd
+            for (int jj = j; jj < max_j; jj++) {
+                row[jj] = alpha * a[jj][ii] + beta * b[jj][ii];
+            }
+        } else if (ta) {
+            const float* other = b[ii];
+            #pragma omp simd
+            for (int jj = j; jj < max_j; jj++) {
+                row[jj] = alpha * a[jj][ii] + beta * other[jj];
+            }
+        } else if (tb) {
+            const float* source = a[ii];
+            #pragma omp simd
+            for (int jj = j; jj < max_j; jj++) {
+                row[jj] = alpha * source[jj] + beta * b[jj][ii];
+            }
+        } else {
+            const float* source = a[ii];
+            const float* other = b[ii];
+            #pragma omp simd
+            for (int jj = j; jj < max_j; jj++) {
+                row[jj] = alpha * source[jj] + beta * other[jj];
+            }
+        }
+    }
+}
+
+void somatcopy_omp(char trans, int n, float alpha, float** a, float** b, int block_size, long double* time) {
+    int ta = parse_trans(trans, "somatcopy_omp");
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    #pragma omp parallel
+    {
+        double region_start = thread_stats_begin();
+        long items = 0;
+
+        #pragma omp for collapse(2) schedule(static) nowait
+        for (int i = 0; i < n; i += block_size) {
+            for (int j = 0; j < n; j += block_size) {
+                TRACE_BEGIN("tile");
+                scale_tile(ta, alpha, a, b, i, j, i + block_size > n ? n : i + block_size,
+                           j + block_size > n ? n : j + block_size);
+                TRACE_END("tile");
+                items++;
+            }
+        }
+
+        thread_stats_busy(region_start, items);
+        #pragma omp barrier
+        thread_stats_end(region_start);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (get_config()->VERBOSE_LEVEL > 1) {
+        printf("Computed B = %g * op(A) (trans %c, block %d) using OMP in: %Lf\n", alpha, trans, block_size, *time);
+    }
+}
+
+void somatadd_omp(char transa, char transb, int n, float alpha, float** a, float beta, float** b, float** c,
+                  int block_size, long double* time) {
+    int ta = parse_trans(transa, "somatadd_omp");
+    int tb = parse_trans(transb, "somatadd_omp");
+    if (tb && c == b) {
+        fprintf(stderr, "somatadd_omp: C can only be B when transb is N\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (beta == 0.0f) {
+        somatcopy_omp(transa, n, alpha, a, c, block_size, time);
+        return;
+    }
+
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    #pragma omp parallel
+    {
+        double region_start = thread_stats_begin();
+        long items = 0;
+
+        #pragma omp for collapse(2) schedule(static) nowait
+        for (int i = 0; i < n; i += block_size) {
+            for (int j = 0; j < n; j += block_size) {
+                TRACE_BEGIN("tile");
+                add_tile(ta, tb, alpha, a, beta, b, c, i, j, i + block_size > n ? n : i + block_size,
+                         j + block_size > n ? n : j + block_size);
+                TRACE_END("tile");
+                items++;
+            }
+        }
+
+        thread_stats_busy(region_start, items);
+        #pragma omp barrier
+        thread_stats_end(region_start);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (get_config()->VERBOSE_LEVEL > 1) {
+        printf("Computed C = %g * op(A) + %g * op(B) (trans %c%c, block %d) using OMP in: %Lf\n",
+               alpha, beta, transa, transb, block_size, *time);
+    }
+}
+
+void somatadd_unfused_omp(int n, float alpha, float** a, float beta, float** b, int block_size, long double* time) {
+    long double transpose_time;
+    float** t = transpose_omp_block_based(a, n, block_size, &transpose_time);
+
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        float* restrict row = b[i];
+        const float* restrict source = t[i];
+        #pragma omp simd
+        for (int j = 0; j < n; j++) {
+            row[j] = alpha * source[j] + beta * row[j];
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = transpose_time + (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    deallocate_matrix(t, n);
+}
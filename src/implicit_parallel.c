@@ -1,5 +1,6 @@
 #include "../include/implicit_parallel.h"
 #include "../include/config.h"
+#include "../include/perf_counters.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -7,6 +8,7 @@
 
 bool is_symmetric_implicit(float **matrix, int n, long double* time) {
     struct timespec start, end;
+    perf_counters_begin();
     clock_gettime(CLOCK_MONOTONIC, &start);
 
     #pragma GCC unroll 4
@@ -17,6 +19,7 @@ bool is_symmetric_implicit(float **matrix, int n, long double* time) {
         for (int j = 0; j < i; j++) {
             if (matrix[i][j] != matrix[j][i]) {
                 clock_gettime(CLOCK_MONOTONIC, &end);
+                perf_counters_end();
                 *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
                 
                 if (get_config()->VERBOSE_LEVEL > 1) {
@@ -29,6 +32,7 @@ bool is_symmetric_implicit(float **matrix, int n, long double* time) {
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
@@ -48,6 +52,7 @@ float** transpose_implicit(float **matrix, int n, long double* time) {
     }
 
     struct timespec start, end;
+    perf_counters_begin();
     clock_gettime(CLOCK_MONOTONIC, &start);
 
     #pragma GCC unroll 4
@@ -61,6 +66,7 @@ float** transpose_implicit(float **matrix, int n, long double* time) {
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
@@ -83,6 +89,7 @@ float** transpose_implicit_block_based(float **matrix, int n, long double* time)
     int BLOCK_SIZE = config->BLOCK_SIZE;
 
     struct timespec start, end;
+    perf_counters_begin();
     clock_gettime(CLOCK_MONOTONIC, &start);
 
     #pragma GCC unroll 4
@@ -104,6 +111,7 @@ float** transpose_implicit_block_based(float **matrix, int n, long double* time)
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
@@ -143,11 +151,13 @@ float** transpose_implicit_cache_oblivious(float ** matrix, int n, long double*
     }
 
     struct timespec start, end;
+    perf_counters_begin();
     clock_gettime(CLOCK_MONOTONIC, &start);
 
     transpose_implicit_recursive(matrix, result, 0, 0, n, n);
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
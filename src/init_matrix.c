@@ -1,12 +1,14 @@
 #include "../include/init_matrix.h"
 #include "../include/config.h"
 #include "../include/utils.h"
+#include "../include/trace.h"
 #include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
 #include <omp.h>
 
 float** init_matrix_sequential(int n) {
+    TRACE_BEGIN("init_matrix_sequential");
     double start = omp_get_wtime();
     srand(time(NULL));
 
@@ -20,6 +22,7 @@ float** init_matrix_sequential(int n) {
     }
 
     printf("\x1b[2K");
+    TRACE_END("init_matrix_sequential");
 
     if (get_config()->VERBOSE_LEVEL > 1) {
         printf("Matrix generated sequentialy:\n");
@@ -37,6 +40,7 @@ float** init_matrix_sequential(int n) {
 
 // Before optimizitations sequential approach was faster
 float** init_matrix_parallel(int n) {
+    TRACE_BEGIN("init_matrix_parallel");
     double start = omp_get_wtime();
 
     float** matrix = (float**)malloc(n * sizeof(float*));
@@ -56,6 +60,7 @@ float** init_matrix_parallel(int n) {
             }
         }
     }
+    TRACE_END("init_matrix_parallel");
 
     if (get_config()->VERBOSE_LEVEL > 1) {
         printf("Matrix generated in parallel:\n");
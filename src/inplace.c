@@ -0,0 +1,292 @@
+#include "../include/inplace.h"
+#include "../include/perf_counters.h"
+#include "../include/thread_stats.h"
+#include "../include/trace.h"
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Element k of an a x b row-major buffer goes to this position of the b x a transpose.
+// The inverse permutation is the same map with a and b swapped.
+static inline size_t next_position(size_t k, size_t a, size_t b) {
+    return (k % b) * a + k / b;
+}
+
+// Moves per batch of short cycles and per segment of a long cycle: enough pieces for the
+// dynamic schedule to balance, few enough that the table stays small next to the data
+static size_t piece_moves(size_t total, int threads) {
+    size_t moves = total / ((size_t)threads * 64);
+    if (moves < 1024) {
+        return 1024;
+    }
+    return moves > (1 << 20) ? 1 << 20 : moves;
+}
+
+static int grow(void** array, size_t* capacity, size_t count, size_t item) {
+    if (count < *capacity) {
+        return 1;
+    }
+    size_t next = *capacity == 0 ? 1024 : *capacity * 2;
+    void* grown = realloc(*array, next * item);
+    if (grown == NULL) {
+        return 0;
+    }
+    *array = grown;
+    *capacity = next;
+    return 1;
+}
+
+InplacePlan* inplace_plan_create(int rows, int cols, int threads) {
+    if (rows <= 0 || cols <= 0 || threads <= 0) {
+        fprintf(stderr, "Invalid in-place plan arguments: %d x %d threads=%d\n", rows, cols, threads);
+        return NULL;
+    }
+
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    InplacePlan* plan = calloc(1, sizeof(InplacePlan));
+    if (plan == NULL) {
+        fprintf(stderr, "Failed to allocate in-place plan.\n");
+        return NULL;
+    }
+    plan->rows = rows;
+    plan->cols = cols;
+    plan->threads = threads;
+
+    // A square buffer is transposed by swapping the triangles, no cycle table is needed
+    if (rows == cols) {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        perf_counters_end();
+        plan->create_time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        return plan;
+    }
+
+    size_t total = (size_t)rows * cols;
+    size_t piece = piece_moves(total, threads);
+
+    // One bit per element, only alive during the leader pass
+    uint64_t* visited = calloc((total + 63) / 64, sizeof(uint64_t));
+    size_t leader_capacity = 0, batch_capacity = 0, segment_capacity = 0;
+    int ok = visited != NULL && grow((void**)&plan->batch_first, &batch_capacity, 0, sizeof(size_t));
+    if (ok) {
+        plan->batch_first[0] = 0;
+    }
+
+    size_t batch_moves = 0;
+    for (size_t k = 1; ok && k + 1 < total; k++) {
+        if (visited[k / 64] >> (k % 64) & 1) {
+            continue;
+        }
+
+        // Walk the cycle once, marking it and cutting it every `piece` moves
+        size_t first_segment = plan->num_segments;
+        size_t segment_start = k;
+        size_t length = 0;
+        size_t q = k;
+        do {
+            visited[q / 64] |= (uint64_t)1 << (q % 64);
+            q = next_position(q, rows, cols);
+            length++;
+            if (length % piece == 0 && q != k) {
+                ok = grow((void**)&plan->segments, &segment_capacity, plan->num_segments, sizeof(InplaceSegment));
+                if (!ok) {
+                    break;
+                }
+                plan->segments[plan->num_segments++] = (InplaceSegment){segment_start, q, piece};
+                segment_start = q;
+            }
+        } while (q != k);
+
+        if (!ok || length == 1) {
+            continue;
+        }
+
+        if (plan->num_segments > first_segment) {
+            ok = grow((void**)&plan->segments, &segment_capacity, plan->num_segments, sizeof(InplaceSegment));
+            if (ok) {
+                size_t moves = length - (plan->num_segments - first_segment) * piece;
+                plan->segments[plan->num_segments++] = (InplaceSegment){segment_start, k, moves};
+            }
+            continue;
+        }
+
+        ok = grow((void**)&plan->leaders, &leader_capacity, plan->num_leaders, sizeof(size_t));
+        if (!ok) {
+            break;
+        }
+        plan->leaders[plan->num_leaders++] = k;
+        batch_moves += length;
+        if (batch_moves >= piece) {
+            ok = grow((void**)&plan->batch_first, &batch_capacity, plan->num_batches + 1, sizeof(size_t));
+            if (ok) {
+                plan->batch_first[++plan->num_batches] = plan->num_leaders;
+            }
+            batch_moves = 0;
+        }
+    }
+
+    if (ok && batch_moves > 0) {
+        ok = grow((void**)&plan->batch_first, &batch_capacity, plan->num_batches + 1, sizeof(size_t));
+        if (ok) {
+            plan->batch_first[++plan->num_batches] = plan->num_leaders;
+        }
+    }
+    free(visited);
+
+    if (ok && plan->num_segments > 0) {
+        plan->carries = malloc(plan->num_segments * sizeof(float));
+        ok = plan->carries != NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate the cycle table of the in-place plan.\n");
+        inplace_plan_destroy(plan);
+        return NULL;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    plan->create_time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return plan;
+}
+
+// Every element of the cycle through `leader` moves one step along next_position(., a, b)
+static void rotate_cycle(float* data, size_t leader, size_t a, size_t b) {
+    // Walking the inverse map pulls each element into the slot it leaves behind
+    float carry = data[leader];
+    size_t q = leader;
+    size_t source = next_position(q, b, a);
+    while (source != leader) {
+        data[q] = data[source];
+        q = source;
+        source = next_position(q, b, a);
+    }
+    data[q] = carry;
+}
+
+// Forward pieces write start+1 .. end from start .. end-1, inverse pieces write start .. end-1
+// from start+1 .. end. The shared end point belongs to the neighbouring piece, hence the carry.
+static void rotate_segment(float* data, const InplaceSegment* segment, float carry, size_t rows, size_t cols,
+                           int inverse) {
+    if (!inverse) {
+        size_t q = segment->end;
+        size_t source = next_position(q, cols, rows);
+        while (source != segment->start) {
+            data[q] = data[source];
+            q = source;
+            source = next_position(q, cols, rows);
+        }
+        data[q] = carry;
+    } else {
+        size_t q = segment->start;
+        size_t source = next_position(q, rows, cols);
+        while (source != segment->end) {
+            data[q] = data[source];
+            q = source;
+            source = next_position(q, rows, cols);
+        }
+        data[q] = carry;
+    }
+}
+
+static void swap_triangles(float* data, int n, int threads) {
+    #pragma omp parallel num_threads(threads)
+    {
+        double region_start = thread_stats_begin();
+        long items = 0;
+
+        #pragma omp for schedule(dynamic, 16) nowait
+        for (int i = 1; i < n; i++) {
+            for (int j = 0; j < i; j++) {
+                float tmp = data[(size_t)i * n + j];
+                data[(size_t)i * n + j] = data[(size_t)j * n + i];
+                data[(size_t)j * n + i] = tmp;
+            }
+            items++;
+        }
+
+        thread_stats_busy(region_start, items);
+        #pragma omp barrier
+        thread_stats_end(region_start);
+    }
+}
+
+void inplace_plan_execute(InplacePlan* plan, float* data, int inverse, long double* time) {
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (plan->rows == plan->cols) {
+        swap_triangles(data, plan->rows, plan->threads);
+    } else {
+        // The inverse of the rows x cols transpose is the transpose of the cols x rows buffer
+        size_t a = inverse ? plan->cols : plan->rows;
+        size_t b = inverse ? plan->rows : plan->cols;
+
+        #pragma omp parallel num_threads(plan->threads)
+        {
+            double region_start = thread_stats_begin();
+
+            // Every carry is read before any piece writes, the implicit barrier keeps it so
+            #pragma omp for schedule(static)
+            for (size_t s = 0; s < plan->num_segments; s++) {
+                const InplaceSegment* segment = &plan->segments[s];
+                plan->carries[s] = data[inverse ? segment->end : segment->start];
+            }
+
+            double busy_start = thread_stats_begin();
+            long items = 0;
+
+            #pragma omp for schedule(dynamic, 1) nowait
+            for (size_t s = 0; s < plan->num_segments; s++) {
+                TRACE_BEGIN("segment");
+                rotate_segment(data, &plan->segments[s], plan->carries[s], plan->rows, plan->cols, inverse);
+                TRACE_END("segment");
+                items++;
+            }
+
+            #pragma omp for schedule(dynamic, 1) nowait
+            for (size_t batch = 0; batch < plan->num_batches; batch++) {
+                TRACE_BEGIN("cycles");
+                for (size_t l = plan->batch_first[batch]; l < plan->batch_first[batch + 1]; l++) {
+                    rotate_cycle(data, plan->leaders[l], a, b);
+                }
+                TRACE_END("cycles");
+                items++;
+            }
+
+            thread_stats_busy(busy_start, items);
+            #pragma omp barrier
+            thread_stats_end(region_start);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void inplace_plan_destroy(InplacePlan* plan) {
+    if (plan == NULL) {
+        return;
+    }
+    free(plan->leaders);
+    free(plan->batch_first);
+    free(plan->segments);
+    free(plan->carries);
+    free(plan);
+}
+
+void transpose_inplace(float* data, int rows, int cols, int threads, long double* time) {
+    InplacePlan* plan = inplace_plan_create(rows, cols, threads);
+    if (plan == NULL) {
+        fprintf(stderr, "Failed to plan the in-place transpose of %d x %d\n", rows, cols);
+        exit(EXIT_FAILURE);
+    }
+    inplace_plan_execute(plan, data, 0, time);
+    *time += plan->create_time;
+    inplace_plan_destroy(plan);
+}
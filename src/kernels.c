@@ -0,0 +1,460 @@
+#include "../include/kernels.h"
+#include "../include/config.h"
+#include "../include/utils.h"
+#include "../include/omp_plan.h"
+#include "../include/mpi_plan.h"
+#include "../include/inplace.h"
+#include "../include/omp_parallel.h"
+#include "../include/tracked.h"
+#include "../include/sparse.h"
+#include "../include/packed.h"
+#include <fnmatch.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int omp_plan_setup(int strategy) {
+    Config* cfg = get_config();
+    cfg->OMP_PLAN = omp_plan_create(cfg->MATRIX_DIMENSION, strategy, cfg->BLOCK_SIZE, cfg->BLOCK_SIZE, cfg->OMP_THREADS);
+    return cfg->OMP_PLAN == NULL ? -1 : 0;
+}
+
+static void omp_plan_teardown(void) {
+    Config* cfg = get_config();
+    omp_plan_destroy(cfg->OMP_PLAN);
+    cfg->OMP_PLAN = NULL;
+}
+
+// Plans are built outside the timed loop so that the runs only measure data movement
+static int mpi_plan_setup(int algorithm) {
+    Config* cfg = get_config();
+    cfg->MPI_PLAN = mpi_plan_create(cfg->CURR_COMM, cfg->MATRIX_DIMENSION, algorithm);
+    return cfg->MPI_PLAN == NULL ? -1 : 0;
+}
+
+static void mpi_plan_teardown(void) {
+    Config* cfg = get_config();
+    mpi_plan_destroy(cfg->MPI_PLAN);
+    cfg->MPI_PLAN = NULL;
+}
+
+// The in-place kernels work on a contiguous copy of MATRIX read as (n / 2) x 2n, which is not
+// square but holds as many elements as the out-of-place kernels move
+static int inplace_setup(int planned) {
+    Config* cfg = get_config();
+    int n = cfg->MATRIX_DIMENSION;
+
+    cfg->INPLACE_DATA = allocate_aligned((size_t)n * n * sizeof(float));
+    if (cfg->INPLACE_DATA == NULL) {
+        fprintf(stderr, "Failed to allocate the buffer of the in-place transpose.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        memcpy(&cfg->INPLACE_DATA[(size_t)i * n], cfg->MATRIX[i], n * sizeof(float));
+    }
+    cfg->INPLACE_TRANSPOSED = 0;
+
+    if (planned) {
+        cfg->INPLACE_PLAN = inplace_plan_create(n / 2, 2 * n, cfg->OMP_THREADS);
+        if (cfg->INPLACE_PLAN != NULL && cfg->VERBOSE_LEVEL > 0) {
+            printf("In-place plan of %d x %d: %zu short cycles in %zu batches, %zu segments, leader pass %.6f s\n",
+                   n / 2, 2 * n, cfg->INPLACE_PLAN->num_leaders, cfg->INPLACE_PLAN->num_batches,
+                   cfg->INPLACE_PLAN->num_segments, cfg->INPLACE_PLAN->create_time);
+        }
+    }
+    return planned && cfg->INPLACE_PLAN == NULL ? -1 : 0;
+}
+
+static void inplace_teardown(void) {
+    Config* cfg = get_config();
+    inplace_plan_destroy(cfg->INPLACE_PLAN);
+    cfg->INPLACE_PLAN = NULL;
+    free(cfg->INPLACE_DATA);
+    cfg->INPLACE_DATA = NULL;
+}
+
+// symmetrize_omp works in place, on a copy of MATRIX in RESULT
+static int symmetrize_setup(int mode) {
+    Config* cfg = get_config();
+    for (int i = 0; i < cfg->MATRIX_DIMENSION; i++) {
+        memcpy(cfg->RESULT[i], cfg->MATRIX[i], cfg->MATRIX_DIMENSION * sizeof(float));
+    }
+    cfg->SYMMETRIZE_MODE = mode;
+    return 0;
+}
+
+// The somatadd entries accumulate into RESULT, which starts as a copy of MATRIX
+static int somatadd_setup(int unused) {
+    (void)unused;
+    Config* cfg = get_config();
+    for (int i = 0; i < cfg->MATRIX_DIMENSION; i++) {
+        memcpy(cfg->RESULT[i], cfg->MATRIX[i], cfg->MATRIX_DIMENSION * sizeof(float));
+    }
+    return 0;
+}
+
+// The tracked entries start from a symmetric copy of MATRIX whose first, full check is not timed
+static int tracked_setup(int unused) {
+    (void)unused;
+    Config* cfg = get_config();
+    long double time;
+    symmetrize_setup(SYMMETRIZE_UPPER_TO_LOWER);
+    symmetrize_omp(cfg->RESULT, cfg->MATRIX_DIMENSION, cfg->BLOCK_SIZE, SYMMETRIZE_UPPER_TO_LOWER, &time);
+
+    cfg->TRACKED = tracked_create(cfg->RESULT, cfg->MATRIX_DIMENSION, cfg->BLOCK_SIZE);
+    if (cfg->TRACKED == NULL) {
+        fprintf(stderr, "Failed to allocate the tracked matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    tracked_is_symmetric(cfg->TRACKED, &time);
+    return 0;
+}
+
+static void tracked_teardown(void) {
+    Config* cfg = get_config();
+    tracked_destroy(cfg->TRACKED);
+    cfg->TRACKED = NULL;
+}
+
+// The sparse entries get a new random symmetric matrix for every density of the sweep. With
+// dense set, RESULT is replaced by its dense form, which csr_from_dense_omp compresses back.
+static int sparse_setup(int dense) {
+    Config* cfg = get_config();
+    cfg->SPARSE = csr_random_symmetric(cfg->MATRIX_DIMENSION, cfg->SPARSE_DENSITY, cfg->MATRIX_DIMENSION);
+    if (cfg->SPARSE == NULL) {
+        fprintf(stderr, "Failed to allocate the sparse matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (dense) {
+        // Freed first, so the dense form takes the place of RESULT rather than adding to it
+        deallocate_matrix(cfg->RESULT, cfg->MATRIX_DIMENSION);
+        cfg->RESULT = csr_to_dense(cfg->SPARSE);
+        if (cfg->RESULT == NULL) {
+            fprintf(stderr, "Failed to allocate the dense form of the sparse matrix.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (cfg->VERBOSE_LEVEL > 0) {
+        printf("Sparse matrix of %d x %d at density %g: %lld entries\n", cfg->MATRIX_DIMENSION,
+               cfg->MATRIX_DIMENSION, cfg->SPARSE_DENSITY, cfg->SPARSE->nnz);
+    }
+    return 0;
+}
+
+static void sparse_teardown(void) {
+    Config* cfg = get_config();
+    csr_destroy(cfg->SPARSE);
+    cfg->SPARSE = NULL;
+}
+
+// Both conversions start from a packed copy of MATRIX, read as symmetric through its upper triangle
+static int packed_setup(int unused) {
+    (void)unused;
+    Config* cfg = get_config();
+    long double time;
+    cfg->PACKED = packed_create(cfg->MATRIX_DIMENSION);
+    if (cfg->PACKED == NULL) {
+        fprintf(stderr, "Failed to allocate the packed matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    dense_to_packed_omp(cfg->MATRIX, cfg->PACKED, cfg->BLOCK_SIZE, &time);
+    return 0;
+}
+
+static void packed_teardown(void) {
+    Config* cfg = get_config();
+    packed_destroy(cfg->PACKED);
+    cfg->PACKED = NULL;
+}
+
+// Bytes an entry has to move at least, for the bandwidth columns. A transpose reads and writes
+// n² floats, a full symmetry check reads both triangles.
+static double transpose_bytes(int n) {
+    return 2.0 * n * n * sizeof(float);
+}
+
+static double triangles_bytes(int n) {
+    return ((double)n * n - n) * sizeof(float);
+}
+
+// Copying one triangle over the other reads one and writes the other
+static double triangle_copy_bytes(int n) {
+    return (double)n * n * sizeof(float);
+}
+
+// The fused operation reads A and B and writes B once, the unfused one adds a second pass
+static double somatadd_bytes(int n) {
+    return 3.0 * n * n * sizeof(float);
+}
+
+static double somatadd_unfused_bytes(int n) {
+    return 5.0 * n * n * sizeof(float);
+}
+
+// Packing reads and writes the n(n+1)/2 elements of a triangle, and so do the scatter and gather
+// of the packed MPI entry. Unpacking reads them and writes the whole square.
+static double pack_bytes(int n) {
+    return ((double)n * n + n) * sizeof(float);
+}
+
+static double unpack_bytes(int n) {
+    return (1.5 * n * n + 0.5 * n) * sizeof(float);
+}
+
+// The sparse entries move their stored entries (index and value) rather than n² floats: the
+// transpose reads and writes each of them once, the symmetry check reads each and its mirror
+static double sparse_bytes(int n) {
+    (void)n;
+    const CSRMatrix* sparse = get_config()->SPARSE;
+    return sparse == NULL ? 0 : 2.0 * sparse->nnz * (sizeof(int) + sizeof(float));
+}
+
+// Compressing reads the dense square twice, to count and to fill, and writes the entries
+static double dense_to_sparse_bytes(int n) {
+    return 2.0 * n * n * sizeof(float) + sparse_bytes(n) / 2;
+}
+
+// Ingestion reads the file once, so the bandwidth columns are the load throughput
+static double input_bytes(int n) {
+    (void)n;
+    return (double)get_config()->INPUT_BYTES;
+}
+
+#define T KERNEL_USES_THREADS
+#define B KERNEL_USES_BLOCK
+#define M KERNEL_NEEDS_MPI
+#define P KERNEL_PREFETCHES
+#define S KERNEL_SPARSE
+
+// In benchmark order. The implicit plans run on one thread, the naive plan uses whole rows
+const KernelDesc kernel_registry[] = {
+    {"load_input", KERNEL_OMP, T | KERNEL_LOADS, load_input_wrapper, NULL, NULL, 0, input_bytes},
+    {"is_symmetric_sequential", KERNEL_SEQUENTIAL, 0, is_symmetric_sequential_wrapper, NULL, NULL, 0, NULL},
+    {"is_symmetric_implicit", KERNEL_IMPLICIT, 0, is_symmetric_implicit_wrapper, NULL, NULL, 0, NULL},
+    {"is_symmetric_omp", KERNEL_OMP, T, is_symmetric_omp_wrapper, NULL, NULL, 0, NULL},
+    {"check_symmetry_omp", KERNEL_OMP, T | B, check_symmetry_omp_wrapper, NULL, NULL, 0, triangles_bytes},
+    {"is_symmetric_tracked", KERNEL_OMP, T | B, is_symmetric_tracked_wrapper, tracked_setup, tracked_teardown, 0, NULL},
+    {"is_symmetric_tracked_full", KERNEL_OMP, T | B, is_symmetric_tracked_full_wrapper, tracked_setup, tracked_teardown, 0, triangles_bytes},
+    {"transpose_sequential", KERNEL_SEQUENTIAL, 0, transpose_sequential_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"transpose_implicit", KERNEL_IMPLICIT, 0, transpose_implicit_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"transpose_auto", KERNEL_OMP, T, transpose_auto_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"transpose_omp", KERNEL_OMP, T, transpose_omp_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"transpose_omp_block_based", KERNEL_OMP, T | B | P, transpose_omp_block_based_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"transpose_omp_tile_distributed", KERNEL_OMP, T | B | P, transpose_omp_tile_distributed_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"transpose_omp_tasks", KERNEL_OMP, T | B | P, transpose_omp_tasks_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"transpose_cache_oblivious", KERNEL_OMP, T | B, transpose_cache_oblivious_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"transpose_cache_oblivious_ws", KERNEL_OMP, T | B, transpose_cache_oblivious_ws_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"transpose_plan_naive", KERNEL_PLAN, T, omp_plan_wrapper, omp_plan_setup, omp_plan_teardown, OMP_PLAN_NAIVE, transpose_bytes},
+    {"transpose_plan_block_based", KERNEL_PLAN, T | B, omp_plan_wrapper, omp_plan_setup, omp_plan_teardown, OMP_PLAN_BLOCK_BASED, transpose_bytes},
+    {"transpose_plan_tile_distributed", KERNEL_PLAN, T | B, omp_plan_wrapper, omp_plan_setup, omp_plan_teardown, OMP_PLAN_TILE_DISTRIBUTED, transpose_bytes},
+    {"transpose_plan_tasks", KERNEL_PLAN, T | B, omp_plan_wrapper, omp_plan_setup, omp_plan_teardown, OMP_PLAN_TASKS, transpose_bytes},
+    {"transpose_plan_implicit", KERNEL_PLAN, 0, omp_plan_wrapper, omp_plan_setup, omp_plan_teardown, OMP_PLAN_IMPLICIT, transpose_bytes},
+    {"transpose_plan_implicit_block_based", KERNEL_PLAN, B, omp_plan_wrapper, omp_plan_setup, omp_plan_teardown, OMP_PLAN_IMPLICIT_BLOCK_BASED, transpose_bytes},
+    {"symmetrize_omp", KERNEL_OMP, T | B, symmetrize_omp_wrapper, symmetrize_setup, NULL, SYMMETRIZE_AVERAGE, transpose_bytes},
+    {"symmetrize_omp_upper", KERNEL_OMP, T | B, symmetrize_omp_wrapper, symmetrize_setup, NULL, SYMMETRIZE_UPPER_TO_LOWER, triangle_copy_bytes},
+    {"symmetrize_omp_lower", KERNEL_OMP, T | B, symmetrize_omp_wrapper, symmetrize_setup, NULL, SYMMETRIZE_LOWER_TO_UPPER, triangle_copy_bytes},
+    {"somatcopy_omp", KERNEL_OMP, T | B, somatcopy_omp_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"somatadd_omp", KERNEL_OMP, T | B, somatadd_omp_wrapper, somatadd_setup, NULL, 0, somatadd_bytes},
+    {"somatadd_unfused_omp", KERNEL_OMP, T | B, somatadd_unfused_omp_wrapper, somatadd_setup, NULL, 0, somatadd_unfused_bytes},
+    {"dense_to_packed_omp", KERNEL_OMP, T | B, dense_to_packed_omp_wrapper, packed_setup, packed_teardown, 0, pack_bytes},
+    {"packed_to_dense_omp", KERNEL_OMP, T | B, packed_to_dense_omp_wrapper, packed_setup, packed_teardown, 0, unpack_bytes},
+    {"csr_transpose_omp", KERNEL_OMP, T | S, csr_transpose_omp_wrapper, sparse_setup, sparse_teardown, 0, sparse_bytes},
+    {"csr_is_symmetric_omp", KERNEL_OMP, T | S, csr_is_symmetric_omp_wrapper, sparse_setup, sparse_teardown, 0, sparse_bytes},
+    {"csr_from_dense_omp", KERNEL_OMP, T | S, csr_from_dense_omp_wrapper, sparse_setup, sparse_teardown, 1, dense_to_sparse_bytes},
+    {"transpose_inplace", KERNEL_OMP, T, transpose_inplace_wrapper, inplace_setup, inplace_teardown, 0, transpose_bytes},
+    {"transpose_inplace_plan", KERNEL_PLAN, T, inplace_plan_wrapper, inplace_setup, inplace_teardown, 1, transpose_bytes},
+    {"is_symmetric_mpi", KERNEL_MPI, T | M | P, is_symmetric_mpi_wrapper, NULL, NULL, 0, NULL},
+    {"check_symmetry_mpi", KERNEL_MPI, T | M, check_symmetry_mpi_wrapper, NULL, NULL, 0, triangles_bytes},
+    {"packed_scatter_gather_mpi", KERNEL_MPI, T | M, packed_scatter_gather_mpi_wrapper, NULL, NULL, 0, pack_bytes},
+    {"transpose_mpi", KERNEL_MPI, T | M | P, transpose_mpi_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"alltoall_transpose_mpi", KERNEL_MPI, T | M | KERNEL_REPLICATES, alltoall_transpose_mpi_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"block_cyclic_transpose_mpi", KERNEL_MPI, T | M | P, block_cyclic_transpose_mpi_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"nonblocking_transpose_mpi", KERNEL_MPI, T | M | P, nonblocking_transpose_mpi_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"streaming_transpose_mpi", KERNEL_MPI, T | M | P | KERNEL_STREAMS, streaming_transpose_mpi_wrapper, NULL, NULL, 0, transpose_bytes},
+    {"transpose_mpi_plan", KERNEL_MPI, T | M, mpi_plan_wrapper, mpi_plan_setup, mpi_plan_teardown, MPI_PLAN_ROW_BLOCK, transpose_bytes},
+    {"alltoall_transpose_mpi_plan", KERNEL_MPI, T | M, mpi_plan_wrapper, mpi_plan_setup, mpi_plan_teardown, MPI_PLAN_ALLTOALL, transpose_bytes},
+    {"block_2d_transpose_mpi_plan", KERNEL_MPI, T | M, mpi_plan_wrapper, mpi_plan_setup, mpi_plan_teardown, MPI_PLAN_BLOCK_2D, transpose_bytes},
+};
+
+#undef T
+#undef B
+#undef M
+#undef P
+#undef S
+
+const int num_kernels = sizeof(kernel_registry) / sizeof(kernel_registry[0]);
+
+static const char* family_names[NUM_KERNEL_FAMILIES] = {"sequential", "implicit", "omp", "plan", "mpi"};
+
+const char* kernel_family_name(KernelFamily family) {
+    return family >= 0 && family < NUM_KERNEL_FAMILIES ? family_names[family] : "unknown";
+}
+
+static int pattern_matches(const char* pattern, int len, const KernelDesc* kernel) {
+    char buf[128];
+    if (len <= 0 || len >= (int)sizeof(buf)) {
+        return 0;
+    }
+    memcpy(buf, pattern, len);
+    buf[len] = '\0';
+    return strcmp(buf, kernel_family_name(kernel->family)) == 0 || fnmatch(buf, kernel->name, 0) == 0;
+}
+
+// Whether any pattern of the comma separated list matches the kernel
+static int list_matches(const char* patterns, const KernelDesc* kernel) {
+    const char* p = patterns;
+    while (*p != '\0') {
+        const char* comma = strchr(p, ',');
+        int len = comma != NULL ? (int)(comma - p) : (int)strlen(p);
+        if (pattern_matches(p, len, kernel)) {
+            return 1;
+        }
+        if (comma == NULL) {
+            break;
+        }
+        p = comma + 1;
+    }
+    return 0;
+}
+
+int kernel_patterns_valid(const char* patterns, const char** unknown, int* unknown_len) {
+    const char* p = patterns;
+    while (1) {
+        const char* comma = strchr(p, ',');
+        int len = comma != NULL ? (int)(comma - p) : (int)strlen(p);
+        int matched = 0;
+        for (int k = 0; k < num_kernels && !matched; k++) {
+            matched = pattern_matches(p, len, &kernel_registry[k]);
+        }
+        if (!matched) {
+            *unknown = p;
+            *unknown_len = len;
+            return 0;
+        }
+        if (comma == NULL) {
+            return 1;
+        }
+        p = comma + 1;
+    }
+}
+
+int kernel_selected(const KernelDesc* kernel) {
+    Config* cfg = get_config();
+    if (cfg->KERNEL_FILTER != NULL && !list_matches(cfg->KERNEL_FILTER, kernel)) {
+        return 0;
+    }
+    if (cfg->KERNEL_EXCLUDE != NULL && list_matches(cfg->KERNEL_EXCLUDE, kernel)) {
+        return 0;
+    }
+    return 1;
+}
+
+int kernel_planned(const KernelDesc* kernel, int threads, int block_size) {
+    Config* cfg = get_config();
+    if (!kernel_selected(kernel)) {
+        return 0;
+    }
+    if (!(kernel->flags & KERNEL_USES_THREADS) && threads != cfg->MIN_OMP_THREADS) {
+        return 0;
+    }
+    if (!(kernel->flags & KERNEL_USES_BLOCK) && block_size != cfg->MIN_BLOCK_SIZE) {
+        return 0;
+    }
+    if ((kernel->flags & KERNEL_LOADS) && cfg->INPUT_PATH == NULL) {
+        return 0;
+    }
+    return 1;
+}
+
+int kernels_planned_count(int threads, int flags) {
+    Config* cfg = get_config();
+    int count = 0;
+    for (int k = 0; k < num_kernels; k++) {
+        const KernelDesc* kernel = &kernel_registry[k];
+        if ((kernel->flags & flags) == flags && kernel_planned(kernel, threads, cfg->MIN_BLOCK_SIZE)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// 0 is followed by 1, then the range doubles like the others
+static int next_prefetch_distance(int distance) {
+    return distance == 0 ? 1 : distance * 2;
+}
+
+// A failed setup skips the entry instead of recording runs that did nothing. MPI entries are
+// skipped by every rank of CURR_COMM when any of them failed, so the collectives still match.
+static int setup_succeeded(const KernelDesc* kernel) {
+    Config* cfg = get_config();
+    int failed = kernel->setup(kernel->arg) != 0;
+    if (kernel->flags & KERNEL_NEEDS_MPI) {
+        MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR, cfg->CURR_COMM);
+    }
+
+    int rank = 0;
+    MPI_Comm_rank(cfg->CURR_COMM, &rank);
+    if (failed && rank == 0) {
+        printf("Skipping %s: its setup failed\n", kernel->name);
+    }
+    return !failed;
+}
+
+void kernel_run(const KernelDesc* kernel) {
+    Config* cfg = get_config();
+
+    // Sparse kernels build their matrix in the setup, once per density. The others run once,
+    // with a density of -1 that leaves the results column empty.
+    int densities = kernel->flags & KERNEL_SPARSE ? cfg->NUM_SPARSE_DENSITIES : 1;
+    for (int d = 0; d < densities; d++) {
+        cfg->SPARSE_DENSITY = kernel->flags & KERNEL_SPARSE ? cfg->SPARSE_DENSITIES[d] : -1;
+        if (kernel->setup != NULL && !setup_succeeded(kernel)) {
+            if (kernel->teardown != NULL) {
+                kernel->teardown();
+            }
+            continue;
+        }
+
+        double bytes_moved = kernel->bytes_moved != NULL ? kernel->bytes_moved(cfg->MATRIX_DIMENSION) : 0;
+
+        // The distance leaves any plan unchanged, so the setup is shared by the whole range.
+        // Kernels without prefetch run once with -1, which leaves the results column empty.
+        int first = kernel->flags & KERNEL_PREFETCHES ? cfg->MIN_PREFETCH_DISTANCE : -1;
+        int last = kernel->flags & KERNEL_PREFETCHES ? cfg->MAX_PREFETCH_DISTANCE : -1;
+        for (int distance = first; distance <= last; distance = distance < 0 ? 0 : next_prefetch_distance(distance)) {
+            cfg->PREFETCH_DISTANCE = distance;
+            if (kernel->flags & KERNEL_NEEDS_MPI) {
+                benchmark_mpi_function(kernel->wrapper, kernel->name, bytes_moved);
+            } else {
+                benchmark_function(kernel->wrapper, kernel->name, bytes_moved);
+            }
+        }
+        cfg->PREFETCH_DISTANCE = cfg->MIN_PREFETCH_DISTANCE;
+
+        if (kernel->teardown != NULL) {
+            kernel->teardown();
+        }
+    }
+    cfg->SPARSE_DENSITY = -1;
+}
+
+void kernel_list(FILE* fp) {
+    fprintf(fp, "%-36s %-11s %s\n", "kernel", "family", "varies with");
+    for (int k = 0; k < num_kernels; k++) {
+        const KernelDesc* kernel = &kernel_registry[k];
+        int flags = kernel->flags;
+        const char* varies = "size";
+        if ((flags & KERNEL_USES_THREADS) && (flags & KERNEL_USES_BLOCK)) {
+            varies = "size, threads, block size";
+        } else if (flags & KERNEL_NEEDS_MPI) {
+            varies = "size, ranks";
+        } else if (flags & KERNEL_USES_THREADS) {
+            varies = "size, threads";
+        } else if (flags & KERNEL_USES_BLOCK) {
+            varies = "size, block size";
+        }
+        fprintf(fp, "%-36s %-11s %s%s%s\n", kernel->name, kernel_family_name(kernel->family), varies,
+                flags & KERNEL_PREFETCHES ? ", prefetch distance" : "", flags & KERNEL_SPARSE ? ", density" : (flags & KERNEL_LOADS ? ", --input" : ""));
+    }
+}
@@ -4,10 +4,18 @@
 #include "../include/init_matrix.h"
 #include "../include/utils.h"
 #include "../include/config.h"
+#include "../include/kernels.h"
+#include "../include/autotune.h"
+#include "../include/stream.h"
+#include "../include/trace.h"
+#include "../include/affinity.h"
+#include "../include/matrix_io.h"
+#include <stdlib.h>
 
 
 int main(int argc, char *argv[]) {
     MPI_Init(&argc, &argv);
+    TRACE_INIT();
 
     init_config(argc, argv);
     Config* cfg = get_config();
@@ -16,8 +24,62 @@ int main(int argc, char *argv[]) {
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
     MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
 
-    for (int size = cfg->MIN_MATRIX_DIMENSION; size <= cfg->MAX_MATRIX_DIMENSION; size *= 2) {
+    affinity_init(cfg->BIND_POLICY);
+
+    if (cfg->STREAM_BASELINE && world_rank == 0) {
+        printf("===== STREAM Calibration =====\n");
+        for (int threads = cfg->MIN_OMP_THREADS; threads <= cfg->MAX_OMP_THREADS && threads <= world_size; threads *= 2) {
+            affinity_bind_team(threads);
+            const StreamResult* stream = stream_calibrate(threads);
+            if (stream != NULL) {
+                printf("%3d threads: copy %8.2f GB/s, triad %8.2f GB/s\n", threads, stream->copy_gbps, stream->triad_gbps);
+            }
+        }
+        printf("\n");
+    }
+
+    // An input file replaces the random matrices, at its own dimension only
+    InputMatrix input = {0};
+    if (cfg->INPUT_PATH != NULL) {
+        int n = 0;
+        if (world_rank == 0) {
+            if (input_load(cfg->INPUT_PATH, &input) != 0) {
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            n = input.n;
+            cfg->INPUT_BYTES = input.bytes;
+            printf("===== Loaded %s (%s, %d x %d): %.1f MB in %.3f s, %.1f MB/s with %d threads =====\n\n",
+                   cfg->INPUT_PATH, input_format_name(input.format), n, n, input.bytes / 1e6, input.seconds,
+                   input.bytes / 1e6 / input.seconds, omp_get_max_threads());
+        }
+        MPI_Bcast(&n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        cfg->MIN_MATRIX_DIMENSION = cfg->MAX_MATRIX_DIMENSION = n;
+    }
+
+    // Stops before doubling past the maximum, which for a maximum of 2^30 would overflow the int
+    for (int size = cfg->MIN_MATRIX_DIMENSION; size <= cfg->MAX_MATRIX_DIMENSION;
+         size = size > cfg->MAX_MATRIX_DIMENSION / 2 ? cfg->MAX_MATRIX_DIMENSION + 1 : size * 2) {
         for (int mpi_procs = cfg->MIN_OMP_THREADS; mpi_procs <= cfg->MAX_OMP_THREADS && mpi_procs <= world_size; mpi_procs *= 2) {
+            // The filters come from the command line, so every rank skips the same points
+            int local_kernels = kernels_planned_count(mpi_procs, 0) - kernels_planned_count(mpi_procs, KERNEL_NEEDS_MPI);
+            int mpi_kernels = kernels_planned_count(mpi_procs, KERNEL_NEEDS_MPI);
+            // The MPI kernels split the rows evenly, which the size of an input file may not allow
+            if (mpi_kernels > 0 && size % mpi_procs != 0) {
+                if (world_rank == 0) {
+                    printf("Skipping the MPI kernels with %d processes: the size %d is not a multiple of it\n", mpi_procs, size);
+                }
+                mpi_kernels = 0;
+            }
+            if (local_kernels == 0 && mpi_kernels == 0 && !cfg->AUTOTUNE) {
+                continue;
+            }
+
+            int flat_root = mpi_kernels > kernels_planned_count(mpi_procs, KERNEL_NEEDS_MPI | KERNEL_STREAMS);
+            int replicated = kernels_planned_count(mpi_procs, KERNEL_NEEDS_MPI | KERNEL_REPLICATES) > 0;
+            if (!memory_fits(matrix_peak_bytes(size, mpi_procs, world_rank, mpi_kernels > 0, flat_root, replicated), size)) {
+                continue;
+            }
+
             MPI_Comm sub_comm;
             int color = world_rank < mpi_procs ? 0 : MPI_UNDEFINED;
             MPI_Comm_split(MPI_COMM_WORLD, color, world_rank, &sub_comm);
@@ -28,76 +90,82 @@ int main(int argc, char *argv[]) {
                 int threads = mpi_procs;
                 cfg->MATRIX_DIMENSION = size;
                 cfg->OMP_THREADS = threads;
+                cfg->BLOCK_SIZE = cfg->MIN_BLOCK_SIZE;
                 omp_set_num_threads(threads);
 
-                if (world_rank == 0) {
+                if (world_rank == 0 && input.matrix != NULL) {
+                    printf("===== Processing %s with %d threads and %d MPI processes =====\n", cfg->INPUT_PATH, threads, mpi_procs);
+                    affinity_bind_team(threads);
+                    cfg->MATRIX = input.matrix;
+                    cfg->RESULT = allocate_matrix(cfg->MATRIX_DIMENSION);
+                } else if (world_rank == 0) {
                     printf("===== Processing Matrix Generation for size %d with %d threads and %d MPI processes =====\n", size, threads, mpi_procs);
+                    affinity_bind_team(threads);
                     float** p = init_matrix_sequential(cfg->MATRIX_DIMENSION);
                     float** m = init_matrix_parallel(cfg->MATRIX_DIMENSION);
 
                     cfg->MATRIX = p;
+                    cfg->RESULT = allocate_matrix(cfg->MATRIX_DIMENSION);
 
                     deallocate_matrix(m, cfg->MATRIX_DIMENSION);
+                }
 
-                    printf("\n===== Processing Symmetricity Checks for size %d with %d threads and %d MPI processes =====\n", size, threads, mpi_procs);
-                    benchmark_function(is_symmetric_sequential_wrapper, "is_symmetric_sequential");
-                    benchmark_function(is_symmetric_implicit_wrapper, "is_symmetric_implicit");
-                    benchmark_function(is_symmetric_omp_wrapper, "is_symmetric_omp");
+                if (world_rank == 0) {
+                    if (cfg->AUTOTUNE) {
+                        printf("\n===== Autotuning for size %d with %d threads =====\n", size, threads);
+                        autotune(size, threads, cfg->WISDOM_PATH);
+                    }
 
-                    printf("\n===== Processing Transpositions for size %d with %d threads and %d MPI processes =====\n", size, threads, mpi_procs);
-                    benchmark_function(transpose_sequential_wrapper, "transpose_sequential");
-                    benchmark_function(transpose_implicit_wrapper, "transpose_implicit");
+                    if (local_kernels > 0) {
+                        printf("\n===== Processing Shared-Memory Kernels for size %d with %d threads and %d MPI processes =====\n", size, threads, mpi_procs);
+                    }
+                    for (int k = 0; k < num_kernels; k++) {
+                        const KernelDesc* kernel = &kernel_registry[k];
+                        if (!(kernel->flags & (KERNEL_USES_BLOCK | KERNEL_NEEDS_MPI)) && kernel_planned(kernel, threads, cfg->BLOCK_SIZE)) {
+                            kernel_run(kernel);
+                        }
+                    }
 
+                    // Only the kernels tiled by BLOCK_SIZE are repeated for every block size
                     for (int block_size = cfg->MIN_BLOCK_SIZE; block_size <= cfg->MAX_BLOCK_SIZE; block_size *= 2) {
                         cfg->BLOCK_SIZE = block_size;
-                        printf("\n--- Block Size: %d ---\n", block_size);
-                        benchmark_function(transpose_omp_wrapper, "transpose_omp");
-                        benchmark_function(transpose_omp_block_based_wrapper, "transpose_omp_block_based");
-                        benchmark_function(transpose_omp_tile_distributed_wrapper, "transpose_omp_tile_distributed");
-                        benchmark_function(transpose_omp_tasks_wrapper, "transpose_omp_tasks");
-
-                        if (cfg->VERBOSE_LEVEL > 0) {
-                            printf("\n %%- Cache-Oblivious Transposition -%%\n");
+                        int printed = 0;
+                        for (int k = 0; k < num_kernels; k++) {
+                            const KernelDesc* kernel = &kernel_registry[k];
+                            if (!(kernel->flags & KERNEL_USES_BLOCK) || (kernel->flags & KERNEL_NEEDS_MPI) ||
+                                !kernel_planned(kernel, threads, block_size)) {
+                                continue;
+                            }
+                            if (!printed) {
+                                printf("\n--- Block Size: %d ---\n", block_size);
+                                printed = 1;
+                            }
+                            kernel_run(kernel);
                         }
-                        benchmark_function(transpose_cache_oblivious_wrapper, "transpose_cache_oblivious");
                     }
+                    cfg->BLOCK_SIZE = cfg->MIN_BLOCK_SIZE;
 
                     printf("\n");
                 }
 
                 MPI_Barrier(cfg->CURR_COMM);
 
-                if (cfg->VERBOSE_LEVEL > 0 && world_rank == 0) {
-                    printf("\n %%- MPI Symmetricity Check -%%\n");
-                }
-                benchmark_function(is_symmetric_mpi_wrapper, "is_symmetric_mpi");
-
-                if (cfg->VERBOSE_LEVEL > 0 && world_rank == 0) {
-                    printf("\n %%- MPI Transposition -%%\n");
-                }
-                benchmark_function(transpose_mpi_wrapper, "transpose_mpi");
-
-                if (cfg->VERBOSE_LEVEL > 0 && world_rank == 0) {
-                    printf("\n %%- MPI All to All Transposition -%%\n");
-                }
-                benchmark_function(alltoall_transpose_mpi_wrapper, "alltoall_transpose_mpi");
-
-                if (cfg->VERBOSE_LEVEL > 0 && world_rank == 0) {
-                    printf("\n %%- MPI Block Cyclic Transposition -%%\n");
-                }
-                benchmark_function(block_cyclic_transpose_mpi_wrapper, "block_cyclic_transpose_mpi");
-
-                if (cfg->VERBOSE_LEVEL > 0 && world_rank == 0) {
-                    printf("\n %%- MPI Nonblocking Transposition -%%\n");
+                // Every rank walks the registry in the same order, so the collectives match up
+                for (int k = 0; k < num_kernels; k++) {
+                    const KernelDesc* kernel = &kernel_registry[k];
+                    if (mpi_kernels == 0 || !(kernel->flags & KERNEL_NEEDS_MPI) || !kernel_planned(kernel, threads, cfg->BLOCK_SIZE)) {
+                        continue;
+                    }
+                    if (cfg->VERBOSE_LEVEL > 0 && world_rank == 0) {
+                        printf("\n %%- MPI kernel %s -%%\n", kernel->name);
+                    }
+                    kernel_run(kernel);
                 }
-                benchmark_function(nonblocking_transpose_mpi_wrapper, "nonblocking_transpose_mpi");
-
-                // if (cfg->VERBOSE_LEVEL > 0 && world_rank == 0) {
-                //     printf("\n %%- MPI Transposition with 2D Decomposition -%%\n");
-                // }
 
                 MPI_Comm_free(&sub_comm);
                 if (world_rank == 0) {
+                    deallocate_matrix(cfg->RESULT, cfg->MATRIX_DIMENSION);
+                    cfg->RESULT = NULL;
                     cfg->CURR_COMM = MPI_COMM_WORLD;
                     printf("\n");
                 }
@@ -106,6 +174,10 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    input_release(&input);
+
+    TRACE_WRITE("trace.json");
+
     MPI_Finalize();
     return 0;
 }
@@ -0,0 +1,554 @@
+#include "../include/matrix_io.h"
+#include "../include/config.h"
+#include "../include/perf_counters.h"
+#include "../include/utils.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <math.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+const char* input_format_name(InputFormat format) {
+    return format == INPUT_NPY ? "npy" : "mtx";
+}
+
+// Maps the whole file read-only, or with private copy-on-write pages when writable is set
+static const char* map_file(const char* path, int populate, int writable, size_t* length) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open the input %s\n", path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "The input %s is empty or cannot be read\n", path);
+        close(fd);
+        return NULL;
+    }
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= populate ? MAP_POPULATE : 0;
+#else
+    (void)populate;
+#endif
+    void* data = mmap(NULL, st.st_size, PROT_READ | (writable ? PROT_WRITE : 0), flags, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Failed to map the input %s\n", path);
+        return NULL;
+    }
+    *length = st.st_size;
+    return data;
+}
+
+// Rows zeroed by the threads that will fill them, released with deallocate_matrix
+static float** allocate_zeroed(int n) {
+    float** matrix = malloc(n * sizeof(float*));
+    if (matrix == NULL) {
+        return NULL;
+    }
+    int failed = 0;
+    #pragma omp parallel for schedule(static) reduction(||:failed)
+    for (int i = 0; i < n; i++) {
+        matrix[i] = calloc(n, sizeof(float));
+        failed = failed || matrix[i] == NULL;
+    }
+    if (failed) {
+        deallocate_matrix(matrix, n);
+        return NULL;
+    }
+    return matrix;
+}
+
+// ---- MatrixMarket ----
+
+enum { MM_REAL, MM_INTEGER, MM_PATTERN };
+enum { MM_GENERAL, MM_SYMMETRIC, MM_SKEW };
+
+static inline int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline void skip_blanks(const char** cursor, const char* end) {
+    while (*cursor < end && is_blank(**cursor)) {
+        (*cursor)++;
+    }
+}
+
+static int parse_index(const char** cursor, const char* end, long long* value) {
+    skip_blanks(cursor, end);
+    const char* p = *cursor;
+    long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9' && v < (1LL << 40)) {
+        v = v * 10 + (*p++ - '0');
+    }
+    if (p == *cursor) {
+        return 0;
+    }
+    *cursor = p;
+    *value = v;
+    return 1;
+}
+
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Decimal digits into a 64-bit mantissa and one scaling by an exact power of ten where
+// possible, which is well within float precision. No locale and no terminating zero needed.
+static int parse_real(const char** cursor, const char* end, double* value) {
+    skip_blanks(cursor, end);
+    const char* p = *cursor;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p++ == '-';
+    }
+
+    uint64_t mantissa = 0;
+    int significant = 0, exponent = 0, any = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, any = 1) {
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            significant += mantissa != 0;
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = 1) {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                significant += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (!any) {
+        return 0;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        int exponent_negative = 0;
+        if (p < end && (*p == '-' || *p == '+')) {
+            exponent_negative = *p++ == '-';
+        }
+        if (p >= end || *p < '0' || *p > '9') {
+            return 0;
+        }
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            e = e < 100000 ? e * 10 + (*p - '0') : e;
+        }
+        exponent += exponent_negative ? -e : e;
+    }
+
+    double v = (double)mantissa;
+    if (exponent > 0) {
+        v = exponent <= 22 ? v * powers_of_ten[exponent] : v * pow(10.0, exponent);
+    } else if (exponent < 0) {
+        v = exponent >= -22 ? v / powers_of_ten[-exponent] : v * pow(10.0, exponent);
+    }
+    *value = negative ? -v : v;
+    *cursor = p;
+    return 1;
+}
+
+// Start of the byte range of thread t: the first line that starts at or after its share
+static size_t chunk_start(const char* data, size_t begin, size_t end, int t, int threads) {
+    if (t == 0) {
+        return begin;
+    }
+    if (t >= threads) {
+        return end;
+    }
+    size_t p = begin + (end - begin) / threads * t;
+    while (p < end && data[p - 1] != '\n') {
+        p++;
+    }
+    return p;
+}
+
+// Moves to the next token of the range, skipping blank lines and comments. 0 at the end.
+static int next_token(const char** cursor, const char* end) {
+    const char* p = *cursor;
+    while (p < end) {
+        if (is_blank(*p) || *p == '\n') {
+            p++;
+        } else if (*p == '%') {
+            while (p < end && *p != '\n') {
+                p++;
+            }
+        } else {
+            break;
+        }
+    }
+    *cursor = p;
+    return p < end;
+}
+
+static inline void store(float** matrix, long long r, long long c, float v, int symmetry) {
+    matrix[r][c] = v;
+    if (symmetry == MM_SYMMETRIC) {
+        matrix[c][r] = v;
+    } else if (symmetry == MM_SKEW) {
+        matrix[c][r] = -v;
+    }
+}
+
+// Reads the banner and the size line, returns the offset of the first entry or 0
+static size_t parse_banner(const char* data, size_t length, int* array, int* field, int* symmetry,
+                           long long* rows, long long* cols, long long* entries) {
+    char object[32], format[32], type[32], structure[32];
+    const char* line_end = memchr(data, '\n', length);
+    if (line_end == NULL || line_end - data > 256) {
+        return 0;
+    }
+    char banner[257];
+    memcpy(banner, data, line_end - data);
+    banner[line_end - data] = '\0';
+    if (sscanf(banner, "%%%%MatrixMarket %31s %31s %31s %31s", object, format, type, structure) != 4 ||
+        strcasecmp(object, "matrix") != 0) {
+        return 0;
+    }
+
+    *array = strcasecmp(format, "array") == 0;
+    if (!*array && strcasecmp(format, "coordinate") != 0) {
+        return 0;
+    }
+    if (strcasecmp(type, "real") == 0 || strcasecmp(type, "double") == 0) {
+        *field = MM_REAL;
+    } else if (strcasecmp(type, "integer") == 0) {
+        *field = MM_INTEGER;
+    } else if (strcasecmp(type, "pattern") == 0 && !*array) {
+        *field = MM_PATTERN;
+    } else {
+        return 0;
+    }
+    if (strcasecmp(structure, "general") == 0) {
+        *symmetry = MM_GENERAL;
+    } else if (strcasecmp(structure, "symmetric") == 0) {
+        *symmetry = MM_SYMMETRIC;
+    } else if (strcasecmp(structure, "skew-symmetric") == 0) {
+        *symmetry = MM_SKEW;
+    } else {
+        return 0;
+    }
+
+    const char* p = line_end + 1;
+    const char* end = data + length;
+    if (!next_token(&p, end) || !parse_index(&p, end, rows) || !parse_index(&p, end, cols)) {
+        return 0;
+    }
+    *entries = *rows * *cols;
+    if (!*array && !parse_index(&p, end, entries)) {
+        return 0;
+    }
+    while (p < end && *p != '\n') {
+        p++;
+    }
+    return p < end ? (size_t)(p + 1 - data) : length;
+}
+
+// Position of value number index in the column-major listing of an array file. Symmetric
+// listings hold the lower triangle, skew-symmetric ones the strictly lower triangle.
+static void array_position(long long index, long long n, int symmetry, long long* r, long long* c) {
+    if (symmetry == MM_GENERAL) {
+        *r = index % n;
+        *c = index / n;
+        return;
+    }
+    int skew = symmetry == MM_SKEW;
+    long long column = 0;
+    while (column < n && index >= n - column - skew) {
+        index -= n - column - skew;
+        column++;
+    }
+    *c = column;
+    *r = column + skew + index;
+}
+
+static float** load_matrix_market(const char* data, size_t length, const char* path, int* n) {
+    int array, field, symmetry;
+    long long rows, cols, entries;
+    size_t body = parse_banner(data, length, &array, &field, &symmetry, &rows, &cols, &entries);
+    if (body == 0) {
+        fprintf(stderr, "%s: unsupported or malformed MatrixMarket header (matrix coordinate|array real|integer|pattern general|symmetric|skew-symmetric)\n", path);
+        return NULL;
+    }
+    if (rows != cols || rows <= 0 || rows > (1 << 30)) {
+        fprintf(stderr, "%s: the kernels need a square matrix, got %lld x %lld\n", path, rows, cols);
+        return NULL;
+    }
+    if (array && symmetry != MM_GENERAL) {
+        entries = symmetry == MM_SKEW ? rows * (rows - 1) / 2 : rows * (rows + 1) / 2;
+    }
+
+    float** matrix = allocate_zeroed(rows);
+    if (matrix == NULL) {
+        fprintf(stderr, "%s: failed to allocate the %lld x %lld matrix\n", path, rows, rows);
+        return NULL;
+    }
+
+    int threads = omp_get_max_threads();
+    long long* counts = calloc(threads + 1, sizeof(long long));
+    if (counts == NULL) {
+        deallocate_matrix(matrix, rows);
+        return NULL;
+    }
+    long long parsed = 0;
+    int failed = 0;
+
+    #pragma omp parallel reduction(+:parsed) reduction(||:failed)
+    {
+        int team = omp_get_num_threads();
+        int t = omp_get_thread_num();
+        const char* p = data + chunk_start(data, body, length, t, team);
+        const char* end = data + chunk_start(data, body, length, t + 1, team);
+        const char* file_end = data + length;
+
+        if (array) {
+            // The position of a value depends on how many come before it, so the values of
+            // every range are counted first
+            long long count = 0;
+            for (const char* q = p; next_token(&q, end); count++) {
+                while (q < end && !is_blank(*q) && *q != '\n') {
+                    q++;
+                }
+            }
+            counts[t + 1] = count;
+            #pragma omp barrier
+            #pragma omp single
+            for (int s = 1; s <= team; s++) {
+                counts[s] += counts[s - 1];
+            }
+
+            long long index = counts[t];
+            long long r = 0, c = 0;
+            array_position(index, rows, symmetry, &r, &c);
+            double v;
+            while (!failed && next_token(&p, end)) {
+                if (index >= entries || !parse_real(&p, file_end, &v)) {
+                    failed = 1;
+                    break;
+                }
+                store(matrix, r, c, (float)v, symmetry);
+                index++;
+                parsed++;
+                if (++r == rows) {
+                    c++;
+                    r = symmetry == MM_GENERAL ? 0 : c + (symmetry == MM_SKEW);
+                }
+            }
+        } else {
+            long long i, j;
+            double v = 1.0;
+            while (!failed && next_token(&p, end)) {
+                if (!parse_index(&p, file_end, &i) || !parse_index(&p, file_end, &j) ||
+                    (field != MM_PATTERN && !parse_real(&p, file_end, &v)) ||
+                    i < 1 || i > rows || j < 1 || j > rows) {
+                    failed = 1;
+                    break;
+                }
+                store(matrix, i - 1, j - 1, (float)v, symmetry);
+                parsed++;
+                while (p < end && *p != '\n') {
+                    p++;
+                }
+            }
+        }
+    }
+    free(counts);
+
+    if (failed || parsed != entries) {
+        fprintf(stderr, "%s: malformed entries (%lld of %lld read)\n", path, parsed, entries);
+        deallocate_matrix(matrix, rows);
+        return NULL;
+    }
+    *n = (int)rows;
+    return matrix;
+}
+
+// ---- NumPy ----
+
+// Value of key in the header dict, e.g. "'descr': '<f4'", or NULL
+static const char* npy_field(const char* header, const char* key) {
+    const char* found = strstr(header, key);
+    if (found == NULL) {
+        return NULL;
+    }
+    found = strchr(found + strlen(key), ':');
+    if (found == NULL) {
+        return NULL;
+    }
+    found++;
+    while (*found == ' ') {
+        found++;
+    }
+    return found;
+}
+
+static int load_npy(const char* path, InputMatrix* input) {
+    size_t length;
+    const char* data = map_file(path, 1, 1, &length);
+    if (data == NULL) {
+        return -1;
+    }
+
+    size_t header_start, header_length;
+    if (length < 10 || memcmp(data, "\x93NUMPY", 6) != 0) {
+        goto malformed;
+    }
+    if (data[6] == 1) {
+        header_length = (unsigned char)data[8] | (unsigned char)data[9] << 8;
+        header_start = 10;
+    } else if (length >= 12 && (data[6] == 2 || data[6] == 3)) {
+        header_length = (unsigned char)data[8] | (unsigned char)data[9] << 8 |
+                        (size_t)(unsigned char)data[10] << 16 | (size_t)(unsigned char)data[11] << 24;
+        header_start = 12;
+    } else {
+        goto malformed;
+    }
+    if (header_start + header_length > length || header_length > 65535) {
+        goto malformed;
+    }
+
+    char header[65536];
+    memcpy(header, data + header_start, header_length);
+    header[header_length] = '\0';
+
+    const char* descr = npy_field(header, "'descr'");
+    const char* order = npy_field(header, "'fortran_order'");
+    const char* shape = npy_field(header, "'shape'");
+    long long rows, cols;
+    if (descr == NULL || order == NULL || shape == NULL || sscanf(shape, "(%lld, %lld)", &rows, &cols) != 2) {
+        goto malformed;
+    }
+    int doubles = strncmp(descr, "'<f8'", 5) == 0;
+    if (!doubles && strncmp(descr, "'<f4'", 5) != 0) {
+        fprintf(stderr, "%s: only '<f4' and '<f8' arrays are supported\n", path);
+        munmap((void*)data, length);
+        return -1;
+    }
+    int fortran = strncmp(order, "True", 4) == 0;
+    if (rows != cols || rows <= 0 || rows > (1 << 30)) {
+        fprintf(stderr, "%s: the kernels need a square 2-D array, got shape %.40s\n", path, shape);
+        munmap((void*)data, length);
+        return -1;
+    }
+    int n = (int)rows;
+    size_t offset = header_start + header_length;
+    if (offset + (size_t)n * n * (doubles ? sizeof(double) : sizeof(float)) > length) {
+        goto malformed;
+    }
+
+    if (!doubles && !fortran && offset % sizeof(float) == 0) {
+        float** matrix = malloc(n * sizeof(float*));
+        if (matrix == NULL) {
+            munmap((void*)data, length);
+            return -1;
+        }
+        float* values = (float*)(data + offset);
+        for (int i = 0; i < n; i++) {
+            matrix[i] = &values[(size_t)i * n];
+        }
+        input->matrix = matrix;
+        input->map = (void*)data;
+        input->map_length = length;
+        input->n = n;
+        return 0;
+    }
+
+    // Fortran order holds the transpose row by row, so element (i, j) is read at j * n + i
+    float** matrix = allocate_zeroed(n);
+    if (matrix == NULL) {
+        fprintf(stderr, "%s: failed to allocate the %d x %d matrix\n", path, n, n);
+        munmap((void*)data, length);
+        return -1;
+    }
+    const char* values = data + offset;
+    size_t element = doubles ? sizeof(double) : sizeof(float);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            size_t at = fortran ? (size_t)j * n + i : (size_t)i * n + j;
+            if (doubles) {
+                double v;
+                memcpy(&v, values + at * element, sizeof(v));
+                matrix[i][j] = (float)v;
+            } else {
+                memcpy(&matrix[i][j], values + at * element, sizeof(float));
+            }
+        }
+    }
+    munmap((void*)data, length);
+    input->matrix = matrix;
+    input->n = n;
+    return 0;
+
+malformed:
+    fprintf(stderr, "%s: malformed .npy file\n", path);
+    munmap((void*)data, length);
+    return -1;
+}
+
+int input_load(const char* path, InputMatrix* input) {
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memset(input, 0, sizeof(InputMatrix));
+
+    size_t length;
+    const char* data = map_file(path, 0, 0, &length);
+    if (data == NULL) {
+        return -1;
+    }
+    input->bytes = length;
+
+    int status;
+    if (length >= 6 && memcmp(data, "\x93NUMPY", 6) == 0) {
+        munmap((void*)data, length);
+        input->format = INPUT_NPY;
+        status = load_npy(path, input);
+    } else if (length >= 14 && strncasecmp(data, "%%MatrixMarket", 14) == 0) {
+        input->format = INPUT_MATRIX_MARKET;
+        input->matrix = load_matrix_market(data, length, path, &input->n);
+        munmap((void*)data, length);
+        status = input->matrix != NULL ? 0 : -1;
+    } else {
+        fprintf(stderr, "%s: neither a MatrixMarket nor a .npy file\n", path);
+        munmap((void*)data, length);
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    input->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (status == 0 && get_config()->VERBOSE_LEVEL > 1) {
+        printf("Loaded %s (%s, %d x %d%s) in %f s, %.1f MB/s\n", path, input_format_name(input->format), input->n,
+               input->n, input->map != NULL ? ", mapped" : "", input->seconds, input->bytes / 1e6 / input->seconds);
+    }
+    return status;
+}
+
+void input_release(InputMatrix* input) {
+    if (input->matrix == NULL) {
+        return;
+    }
+    if (input->map != NULL) {
+        free(input->matrix);
+        munmap(input->map, input->map_length);
+    } else {
+        deallocate_matrix(input->matrix, input->n);
+    }
+    memset(input, 0, sizeof(InputMatrix));
+}
@@ -1,5 +1,7 @@
 #include "../include/mpi_parallel.h"
+#include "../include/config.h"
 #include "../include/utils.h"
+#include "../include/mpi_phases.h"
 #include <mpi.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,15 +9,43 @@
 #include <stdbool.h>
 #include <math.h>
 
+MPI_Datatype mpi_row_type(int len) {
+    MPI_Datatype type;
+    MPI_Type_contiguous(len, MPI_FLOAT, &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+// dst (cols x rows) = transpose of src (rows x cols). The writes are the strided side, so with
+// --prefetch-distance every 16th source row, where new destination cache lines start, prefetches
+// the destination row that many columns ahead.
+static void transpose_local(const float* restrict src, float* restrict dst, int rows, int cols) {
+    int distance = get_config()->PREFETCH_DISTANCE;
+    for (int i = 0; i < rows; i++) {
+        if (distance > 0 && i % 16 == 0) {
+            for (int j = 0; j < cols; j++) {
+                if (j + distance < cols) {
+                    __builtin_prefetch(&dst[(size_t)(j + distance) * rows + i], 1, 1);
+                }
+                dst[(size_t)j * rows + i] = src[(size_t)i * cols + j];
+            }
+        } else {
+            for (int j = 0; j < cols; j++) {
+                dst[(size_t)j * rows + i] = src[(size_t)i * cols + j];
+            }
+        }
+    }
+}
+
 // Function to flatten the 2D matrix into a 1D array
 float* flatten_matrix(float** matrix, int n) {
-    float* flat = malloc(n * n * sizeof(float));
+    float* flat = malloc((size_t)n * n * sizeof(float));
     if (flat == NULL) {
         fprintf(stderr, "Failed to allocate memory for flat_matrix.\n");
         return NULL;
     }
     for(int i = 0; i < n; i++) {
-        memcpy(&flat[i * n], matrix[i], n * sizeof(float));
+        memcpy(&flat[(size_t)i * n], matrix[i], n * sizeof(float));
     }
     return flat;
 }
@@ -38,7 +68,7 @@ float** create_2d_matrix(float* flat, int rows, int cols) {
             free(matrix);
             return NULL;
         }
-        memcpy(matrix[i], &flat[i * cols], cols * sizeof(float));
+        memcpy(matrix[i], &flat[(size_t)i * cols], cols * sizeof(float));
     }
 
     return matrix;
@@ -48,6 +78,9 @@ bool is_symmetric_mpi(MPI_Comm comm, float **matrix, int n, int rank, int size,
     float* flat_matrix = NULL;
     float* flat_transposed = NULL;
 
+    double start_time = mpi_phases_begin();
+    double mark = start_time;
+
     // Enhanced Debugging Print
     if (verbosity >= 2) {
         printf("Starting is_symmetric_mpi on rank %d\n", rank);
@@ -73,23 +106,26 @@ bool is_symmetric_mpi(MPI_Comm comm, float **matrix, int n, int rank, int size,
             return false;
         }
     }
+    mpi_phase_end(PHASE_FLATTEN, &mark);
 
     // Allocate memory for the local chunk
-    float* local_matrix = malloc(rows_per_proc * n * sizeof(float));
+    float* local_matrix = malloc((size_t)rows_per_proc * n * sizeof(float));
     if (local_matrix == NULL) {
         fprintf(stderr, "Failed to allocate memory for local_matrix on rank %d.\n", rank);
         if (rank == 0) free(flat_matrix);
         return false;
     }
 
+    MPI_Datatype row = mpi_row_type(n);
+
     // Scatter the matrix rows to all processes
     int scatter_err = MPI_Scatter(
         flat_matrix,                    // send buffer (root)
-        rows_per_proc * n,              // send count per process
-        MPI_FLOAT,                      // send type
+        rows_per_proc,                  // send count per process
+        row,                            // send type
         local_matrix,                   // receive buffer
-        rows_per_proc * n,              // receive count
-        MPI_FLOAT,                      // receive type
+        rows_per_proc,                  // receive count
+        row,                            // receive type
         0,                              // root
         comm                            // communicator
     );
@@ -98,50 +134,50 @@ bool is_symmetric_mpi(MPI_Comm comm, float **matrix, int n, int rank, int size,
         fprintf(stderr, "MPI_Scatter failed on rank %d.\n", rank);
         if (rank == 0) free(flat_matrix);
         free(local_matrix);
+        MPI_Type_free(&row);
         return false;
     }
 
-    // Start timing after scattering
     MPI_Barrier(comm); // Ensure all processes have received their data
-    double start_time = MPI_Wtime();
+    mpi_phase_end(PHASE_DISTRIBUTE, &mark);
 
     // Transpose the local chunk
-    float* local_transposed = malloc(rows_per_proc * n * sizeof(float));
+    float* local_transposed = malloc((size_t)rows_per_proc * n * sizeof(float));
     if (local_transposed == NULL) {
         fprintf(stderr, "Failed to allocate memory for local_transposed on rank %d.\n", rank);
         if (rank == 0) free(flat_matrix);
         free(local_matrix);
+        MPI_Type_free(&row);
         return false;
     }
 
-    for (int i = 0; i < rows_per_proc; i++) {
-        for (int j = 0; j < n; j++) {
-            local_transposed[j * rows_per_proc + i] = local_matrix[i * n + j];
-        }
-    }
+    transpose_local(local_matrix, local_transposed, rows_per_proc, n);
+    mpi_phase_end(PHASE_COMPUTE, &mark);
 
     // Gather the transposed chunks back to the root
     if (rank == 0) {
-        flat_transposed = malloc(n * n * sizeof(float));
+        flat_transposed = malloc((size_t)n * n * sizeof(float));
         if (flat_transposed == NULL) {
             fprintf(stderr, "Failed to allocate memory for flat_transposed on root.\n");
             free(flat_matrix);
             free(local_matrix);
             free(local_transposed);
+            MPI_Type_free(&row);
             return false;
         }
     }
 
     int gather_err = MPI_Gather(
         local_transposed,               // send buffer
-        rows_per_proc * n,              // send count
-        MPI_FLOAT,                      // send type
+        rows_per_proc,                  // send count
+        row,                            // send type
         flat_transposed,                // receive buffer (root)
-        rows_per_proc * n,              // receive count
-        MPI_FLOAT,                      // receive type
+        rows_per_proc,                  // receive count
+        row,                            // receive type
         0,                              // root
         comm                            // communicator
     );
+    MPI_Type_free(&row);
 
     if (gather_err != MPI_SUCCESS) {
         fprintf(stderr, "MPI_Gather failed on rank %d.\n", rank);
@@ -152,25 +188,25 @@ bool is_symmetric_mpi(MPI_Comm comm, float **matrix, int n, int rank, int size,
         return false;
     }
 
-    // End timing after gathering
-    double end_time = MPI_Wtime();
-    *time = end_time - start_time;
+    mpi_phase_end(PHASE_GATHER, &mark);
 
     // Check symmetry on the root process
     bool is_symmetric = true;
     if (rank == 0) {
         for (int i = 0; i < n && is_symmetric; i++) {
             for (int j = 0; j < n && is_symmetric; j++) {
-                if (flat_matrix[i * n + j] != flat_transposed[i * n + j]) {
+                if (flat_matrix[(size_t)i * n + j] != flat_transposed[(size_t)i * n + j]) {
                     is_symmetric = false;
                 }
             }
         }
         free(flat_transposed);
     }
+    mpi_phase_end(PHASE_COMPUTE, &mark);
 
     // Broadcast the result to all processes
     MPI_Bcast(&is_symmetric, 1, MPI_C_BOOL, 0, comm);
+    mpi_phase_end(PHASE_EXCHANGE, &mark);
 
     // Cleanup
     if (rank == 0) {
@@ -179,6 +215,8 @@ bool is_symmetric_mpi(MPI_Comm comm, float **matrix, int n, int rank, int size,
     free(local_matrix);
     free(local_transposed);
 
+    *time = mpi_phases_finish(start_time);
+
     // Enhanced Debugging Print
     if (verbosity >= 2) {
         printf("is_symmetric_mpi completed successfully on rank %d\n", rank);
@@ -192,6 +230,9 @@ float** transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size,
     float* flat_matrix = NULL;
     float* flat_transposed = NULL;
 
+    double start_time = mpi_phases_begin();
+    double mark = start_time;
+
     // Enhanced Debugging Print
     if (verbosity >= 2) {
         printf("Rank %d: Starting transpose_mpi\n", rank);
@@ -214,12 +255,15 @@ float** transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size,
         }
     }
 
+    mpi_phase_end(PHASE_FLATTEN, &mark);
+
     // Calculate the number of rows per process
     int rows_per_proc = n / size; // Guaranteed to be integer since n and size are powers of two and size < n
     // No remainder due to n divisible by size and both being powers of two
+    MPI_Datatype row = mpi_row_type(n);
 
     // Allocate memory for the local chunk
-    float* local_matrix = malloc(rows_per_proc * n * sizeof(float));
+    float* local_matrix = malloc((size_t)rows_per_proc * n * sizeof(float));
     if (local_matrix == NULL) {
         fprintf(stderr, "Rank %d: Failed to allocate memory for local_matrix.\n", rank);
         MPI_Abort(comm, EXIT_FAILURE);
@@ -234,11 +278,11 @@ float** transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size,
     // Scatter the matrix rows to all processes
     int scatter_err = MPI_Scatter(
         flat_matrix,                    // send buffer (root)
-        rows_per_proc * n,              // send count per process
-        MPI_FLOAT,                      // send type
+        rows_per_proc,                  // send count per process
+        row,                            // send type
         local_matrix,                   // receive buffer
-        rows_per_proc * n,              // receive count
-        MPI_FLOAT,                      // receive type
+        rows_per_proc,                  // receive count
+        row,                            // receive type
         0,                              // root
         comm                  // communicator
     );
@@ -259,36 +303,28 @@ float** transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size,
         fflush(stdout);
     }
 
-    // Measure the start time
-    double start_time = MPI_Wtime();
+    mpi_phase_end(PHASE_DISTRIBUTE, &mark);
 
     // Transpose the local chunk
-    float* local_transposed = malloc(rows_per_proc * n * sizeof(float));
+    float* local_transposed = malloc((size_t)rows_per_proc * n * sizeof(float));
     if (local_transposed == NULL) {
         fprintf(stderr, "Rank %d: Failed to allocate memory for local_transposed.\n", rank);
         MPI_Abort(comm, EXIT_FAILURE);
     }
 
-    for(int i = 0; i < rows_per_proc; i++) {
-        for(int j = 0; j < n; j++) {
-            // Correct indexing for transposed data
-            local_transposed[j * rows_per_proc + i] = local_matrix[i * n + j];
-        }
-    }
+    transpose_local(local_matrix, local_transposed, rows_per_proc, n);
 
-    // Measure the end time
-    double end_time = MPI_Wtime();
-    *time = end_time - start_time;
+    mpi_phase_end(PHASE_COMPUTE, &mark);
 
     // Debugging Print after Local Transpose
     if (verbosity >= 2) {
-        printf("Rank %d: Local transposition completed in %Lf seconds\n", rank, *time);
+        printf("Rank %d: Local transposition completed in %f seconds\n", rank, mpi_phases_last()->seconds[PHASE_COMPUTE]);
         fflush(stdout);
     }
 
     // Allocate memory for the transposed flat matrix on root
     if(rank == 0) {
-        flat_transposed = malloc(n * n * sizeof(float));
+        flat_transposed = malloc((size_t)n * n * sizeof(float));
         if (flat_transposed == NULL) {
             fprintf(stderr, "Root Rank %d: Failed to allocate memory for flat_transposed.\n", rank);
             MPI_Abort(comm, EXIT_FAILURE);
@@ -304,11 +340,11 @@ float** transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size,
     // Gather the transposed chunks back to the root
     int gather_err = MPI_Gather(
         local_transposed,               // send buffer
-        rows_per_proc * n,              // send count
-        MPI_FLOAT,                      // send type
+        rows_per_proc,                  // send count
+        row,                            // send type
         flat_transposed,                // receive buffer (root)
-        rows_per_proc * n,              // receive count
-        MPI_FLOAT,                      // receive type
+        rows_per_proc,                  // receive count
+        row,                            // receive type
         0,                              // root
         comm                  // communicator
     );
@@ -317,6 +353,9 @@ float** transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size,
         fprintf(stderr, "Rank %d: MPI_Gather failed.\n", rank);
         MPI_Abort(comm, gather_err);
     }
+    MPI_Type_free(&row);
+
+    mpi_phase_end(PHASE_GATHER, &mark);
 
     // Debugging Print after Gather
     if (verbosity >= 2) {
@@ -340,6 +379,9 @@ float** transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size,
     // Cleanup
     free(local_matrix);
     free(local_transposed);
+    mpi_phase_end(PHASE_REBUILD, &mark);
+
+    *time = mpi_phases_finish(start_time);
 
     // Debugging Print at End
     if (verbosity >= 2) {
@@ -354,6 +396,9 @@ float** alltoall_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, i
     float* flat_matrix = NULL;
     float* transposed_flat = NULL;
 
+    double start_time = mpi_phases_begin();
+    double mark = start_time;
+
     // Enhanced Debugging Print
     if (verbosity >= 2) {
         printf("Rank %d: Starting alltoall_transpose_mpi\n", rank);
@@ -368,22 +413,27 @@ float** alltoall_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, i
             MPI_Abort(comm, EXIT_FAILURE);
         }
     } else {
-        flat_matrix = malloc(n * n * sizeof(float));
+        flat_matrix = malloc((size_t)n * n * sizeof(float));
         if (flat_matrix == NULL) {
             fprintf(stderr, "Rank %d: Failed to allocate buffer for flat_matrix.\n", rank);
             MPI_Abort(comm, EXIT_FAILURE);
         }
     }
 
+    mpi_phase_end(PHASE_FLATTEN, &mark);
+
     // Broadcast the flattened matrix to all processes
-    MPI_Bcast(flat_matrix, n * n, MPI_FLOAT, 0, comm);
+    MPI_Datatype row = mpi_row_type(n);
+    MPI_Bcast(flat_matrix, n, row, 0, comm);
+    MPI_Type_free(&row);
+    mpi_phase_end(PHASE_DISTRIBUTE, &mark);
 
     // Determine the block size for each process
     int block_size = n / size;
 
     // Allocate buffer for sending and receiving
-    float* send_buffer = malloc(block_size * n * sizeof(float));
-    float* recv_buffer = malloc(block_size * n * sizeof(float));
+    float* send_buffer = malloc((size_t)block_size * n * sizeof(float));
+    float* recv_buffer = malloc((size_t)block_size * n * sizeof(float));
     if (send_buffer == NULL || recv_buffer == NULL) {
         fprintf(stderr, "Rank %d: Failed to allocate send/recv buffers.\n", rank);
         MPI_Abort(comm, EXIT_FAILURE);
@@ -392,23 +442,22 @@ float** alltoall_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, i
     // Prepare send buffer: each process sends its block of rows
     for(int i = 0; i < block_size; i++) {
         for(int j = 0; j < n; j++) {
-            send_buffer[i * n + j] = flat_matrix[(rank * block_size + i) * n + j];
+            send_buffer[(size_t)i * n + j] = flat_matrix[(size_t)(rank * block_size + i) * n + j];
         }
     }
 
-    // Measure the start time
-    double start_time = MPI_Wtime();
+    mpi_phase_end(PHASE_COMPUTE, &mark);
 
     // Perform all-to-all communication
-    MPI_Alltoall(send_buffer, block_size * n / size, MPI_FLOAT,
-                 recv_buffer, block_size * n / size, MPI_FLOAT, comm);
-
-    // Measure the end time
-    double end_time = MPI_Wtime();
-    *time = (long double)(end_time - start_time);
+    // Each rank gets block_size * n / size floats, sent as rows of n / size floats
+    MPI_Datatype piece = mpi_row_type(n / size);
+    MPI_Alltoall(send_buffer, block_size, piece,
+                 recv_buffer, block_size, piece, comm);
+    MPI_Type_free(&piece);
+    mpi_phase_end(PHASE_EXCHANGE, &mark);
 
     // Allocate memory for the transposed flat matrix on all processes
-    transposed_flat = malloc(n * n * sizeof(float));
+    transposed_flat = malloc((size_t)n * n * sizeof(float));
     if (transposed_flat == NULL) {
         fprintf(stderr, "Rank %d: Failed to allocate memory for transposed_flat.\n", rank);
         MPI_Abort(comm, EXIT_FAILURE);
@@ -418,11 +467,13 @@ float** alltoall_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, i
     for(int p = 0; p < size; p++) {
         for(int i = 0; i < block_size; i++) {
             for(int j = 0; j < block_size; j++) {
-                transposed_flat[j * n + p * block_size + i] = recv_buffer[p * block_size * n / size + i * (n / size) + j];
+                transposed_flat[(size_t)j * n + p * block_size + i] = recv_buffer[(size_t)p * block_size * (n / size) + (size_t)i * (n / size) + j];
             }
         }
     }
 
+    mpi_phase_end(PHASE_COMPUTE, &mark);
+
     // Create the 2D transposed matrix
     float** transposed = create_2d_matrix(transposed_flat, n, n);
     if(rank == 0 && transposed == NULL) {
@@ -435,6 +486,9 @@ float** alltoall_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, i
     free(send_buffer);
     free(recv_buffer);
     free(transposed_flat);
+    mpi_phase_end(PHASE_REBUILD, &mark);
+
+    *time = mpi_phases_finish(start_time);
 
     // Debugging Print at End
     if (verbosity >= 2) {
@@ -446,6 +500,9 @@ float** alltoall_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, i
 }
 
 float** block_cyclic_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size, long double* time, int verbosity) {
+    double start_time = mpi_phases_begin();
+    double mark = start_time;
+
     int dims[2] = {0, 0}; // Let MPI_Dims_create determine the dimensions
     MPI_Comm grid_comm;
     
@@ -487,12 +544,14 @@ float** block_cyclic_transpose_mpi(MPI_Comm comm, float** matrix, int n, int ran
     int block_cols = n / dims[1];
     
     // Allocate local block
-    float* local_block = malloc(block_rows * block_cols * sizeof(float));
+    float* local_block = malloc((size_t)block_rows * block_cols * sizeof(float));
     if (local_block == NULL) {
         fprintf(stderr, "Rank %d: Failed to allocate local_block.\n", rank);
         MPI_Abort(comm, EXIT_FAILURE);
     }
     
+    mpi_phase_end(PHASE_SETUP, &mark);
+
     // Only root process flattens the matrix
     float* flat_matrix = NULL;
     if(rank == 0) {
@@ -503,14 +562,19 @@ float** block_cyclic_transpose_mpi(MPI_Comm comm, float** matrix, int n, int ran
         }
     }
     
+    mpi_phase_end(PHASE_FLATTEN, &mark);
+
     // Create a datatype for a subarray (block)
     MPI_Datatype block_type, block_type_resized;
     MPI_Type_create_subarray(2, (int[]){n, n}, (int[]){block_rows, block_cols},
                             (int[]){coords[0] * block_rows, coords[1] * block_cols},
                             MPI_ORDER_C, MPI_FLOAT, &block_type);
-    MPI_Type_create_resized(block_type, 0, block_cols * sizeof(float), &block_type_resized);
+    MPI_Type_create_resized(block_type, 0, (MPI_Aint)block_cols * sizeof(float), &block_type_resized);
     MPI_Type_commit(&block_type_resized);
+    MPI_Datatype block_row = mpi_row_type(block_cols);
     
+    mpi_phase_end(PHASE_SETUP, &mark);
+
     // Prepare send counts and displacements
     int send_counts[size];
     int displs[size];
@@ -523,37 +587,27 @@ float** block_cyclic_transpose_mpi(MPI_Comm comm, float** matrix, int n, int ran
     
     // Scatter the blocks to all processes
     MPI_Scatterv(flat_matrix, send_counts, displs, block_type_resized,
-                local_block, block_rows * block_cols, MPI_FLOAT,
+                local_block, block_rows, block_row,
                 0, grid_comm);
     
-    // Start timing
-    MPI_Barrier(grid_comm); // Synchronize before timing
-    double start_time = MPI_Wtime();
+    MPI_Barrier(grid_comm);
+    mpi_phase_end(PHASE_DISTRIBUTE, &mark);
     
     // Transpose the local block
     // Allocate a temporary buffer for transposed block
-    float* temp_transposed = malloc(block_rows * block_cols * sizeof(float));
+    float* temp_transposed = malloc((size_t)block_rows * block_cols * sizeof(float));
     if (temp_transposed == NULL) {
         fprintf(stderr, "Rank %d: Failed to allocate temp_transposed.\n", rank);
         MPI_Abort(comm, EXIT_FAILURE);
     }
     
-    for(int i = 0; i < block_rows; i++) {
-        for(int j = 0; j < block_cols; j++) {
-            temp_transposed[j * block_rows + i] = local_block[i * block_cols + j];
-        }
-    }
+    transpose_local(local_block, temp_transposed, block_rows, block_cols);
     
     // Copy transposed data back to local_block
-    for(int i = 0; i < block_rows * block_cols; i++) {
-        local_block[i] = temp_transposed[i];
-    }
+    memcpy(local_block, temp_transposed, (size_t)block_rows * block_cols * sizeof(float));
     
     free(temp_transposed);
-    
-    // End timing
-    double end_time = MPI_Wtime();
-    *time = (long double)(end_time - start_time);
+    mpi_phase_end(PHASE_COMPUTE, &mark);
     
     // Create the transposed grid communicator (switch rows and columns)
     // Optional: Depending on how you want to gather the blocks, you might need to rearrange the grid
@@ -563,16 +617,17 @@ float** block_cyclic_transpose_mpi(MPI_Comm comm, float** matrix, int n, int ran
     // Gather the transposed blocks back to the root
     float* transposed_flat = NULL;
     if(rank == 0) {
-        transposed_flat = malloc(n * n * sizeof(float));
+        transposed_flat = malloc((size_t)n * n * sizeof(float));
         if (transposed_flat == NULL) {
             fprintf(stderr, "Root Rank %d: Failed to allocate transposed_flat.\n", rank);
             MPI_Abort(comm, EXIT_FAILURE);
         }
     }
     
-    MPI_Gatherv(local_block, block_rows * block_cols, MPI_FLOAT,
+    MPI_Gatherv(local_block, block_rows, block_row,
                 transposed_flat, send_counts, displs, block_type_resized,
                 0, grid_comm);
+    mpi_phase_end(PHASE_GATHER, &mark);
     
     // Reconstruct the transposed matrix on the root
     float** transposed = NULL;
@@ -592,8 +647,12 @@ float** block_cyclic_transpose_mpi(MPI_Comm comm, float** matrix, int n, int ran
     }
     MPI_Type_free(&block_type);
     MPI_Type_free(&block_type_resized);
+    MPI_Type_free(&block_row);
     MPI_Comm_free(&grid_comm);
     // No separate transposed_grid_comm in this simplified example
+    mpi_phase_end(PHASE_REBUILD, &mark);
+
+    *time = mpi_phases_finish(start_time);
     
     // Debugging Print at End
     if (verbosity >= 2) {
@@ -608,6 +667,9 @@ float** nonblocking_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank
     float* flat_matrix = NULL;
     float* transposed_flat = NULL;
 
+    double start_time = mpi_phases_begin();
+    double mark = start_time;
+
     // Enhanced Debugging Print
     if (verbosity >= 2) {
         printf("Rank %d: Starting nonblocking_transpose_mpi\n", rank);
@@ -623,15 +685,18 @@ float** nonblocking_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank
         }
     }
 
+    mpi_phase_end(PHASE_FLATTEN, &mark);
+
     // Broadcast the flattened matrix size to all processes
     MPI_Bcast(&n, 1, MPI_INT, 0, comm);
 
     // Determine the number of rows per process
     int rows_per_proc = n / size;
     // No remainder due to n divisible by size and both being powers of two
+    MPI_Datatype row = mpi_row_type(n);
 
     // Allocate memory for the local chunk
-    float* local_matrix = malloc(rows_per_proc * n * sizeof(float));
+    float* local_matrix = malloc((size_t)rows_per_proc * n * sizeof(float));
     if (local_matrix == NULL) {
         fprintf(stderr, "Rank %d: Failed to allocate local_matrix.\n", rank);
         MPI_Abort(comm, EXIT_FAILURE);
@@ -639,8 +704,8 @@ float** nonblocking_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank
 
     // Non-blocking scatter
     MPI_Request scatter_req;
-    MPI_Iscatter(flat_matrix, rows_per_proc * n, MPI_FLOAT,
-                local_matrix, rows_per_proc * n, MPI_FLOAT,
+    MPI_Iscatter(flat_matrix, rows_per_proc, row,
+                local_matrix, rows_per_proc, row,
                 0, comm, &scatter_req);
 
     // Start computation (if any pre-processing is needed)
@@ -650,7 +715,7 @@ float** nonblocking_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank
     MPI_Wait(&scatter_req, MPI_STATUS_IGNORE);
 
     // Allocate memory for the local transposed chunk
-    float* local_transposed = malloc(rows_per_proc * n * sizeof(float));
+    float* local_transposed = malloc((size_t)rows_per_proc * n * sizeof(float));
     if (local_transposed == NULL) {
         fprintf(stderr, "Rank %d: Failed to allocate local_transposed.\n", rank);
         MPI_Abort(comm, EXIT_FAILURE);
@@ -664,23 +729,16 @@ float** nonblocking_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank
     // However, in pure MPI C, true overlapping would require pthreads or similar
     // Here, we'll proceed with the standard approach for simplicity
 
-    // Measure the start time
-    double start_time = MPI_Wtime();
+    mpi_phase_end(PHASE_DISTRIBUTE, &mark);
 
     // Perform local transpose
-    for(int i = 0; i < rows_per_proc; i++) {
-        for(int j = 0; j < n; j++) {
-            local_transposed[j * rows_per_proc + i] = local_matrix[i * n + j];
-        }
-    }
+    transpose_local(local_matrix, local_transposed, rows_per_proc, n);
 
-    // Measure the end time
-    double end_time = MPI_Wtime();
-    *time = (long double)(end_time - start_time);
+    mpi_phase_end(PHASE_COMPUTE, &mark);
 
     // Allocate memory for the transposed flat matrix on root
     if(rank == 0) {
-        transposed_flat = malloc(n * n * sizeof(float));
+        transposed_flat = malloc((size_t)n * n * sizeof(float));
         if (transposed_flat == NULL) {
             fprintf(stderr, "Root Rank %d: Failed to allocate transposed_flat.\n", rank);
             MPI_Abort(comm, EXIT_FAILURE);
@@ -689,14 +747,16 @@ float** nonblocking_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank
 
     // Non-blocking gather
     MPI_Request gather_req;
-    MPI_Igather(local_transposed, rows_per_proc * n, MPI_FLOAT,
-                transposed_flat, rows_per_proc * n, MPI_FLOAT,
+    MPI_Igather(local_transposed, rows_per_proc, row,
+                transposed_flat, rows_per_proc, row,
                 0, comm, &gather_req);
 
     // Continue with other computations if needed while gather is in progress
 
     // Wait for gather to complete
     MPI_Wait(&gather_req, MPI_STATUS_IGNORE);
+    MPI_Type_free(&row);
+    mpi_phase_end(PHASE_GATHER, &mark);
 
     // Root process reconstructs the transposed matrix
     float** transposed = NULL;
@@ -714,6 +774,9 @@ float** nonblocking_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank
     // Cleanup
     free(local_matrix);
     free(local_transposed);
+    mpi_phase_end(PHASE_REBUILD, &mark);
+
+    *time = mpi_phases_finish(start_time);
 
     // Debugging Print at End
     if (verbosity >= 2) {
@@ -723,3 +786,136 @@ float** nonblocking_transpose_mpi(MPI_Comm comm, float** matrix, int n, int rank
 
     return transposed;
 }
+
+#define TAG_STREAM_ROWS 200
+#define TAG_STREAM_COLUMNS 201
+
+static int min_int(int a, int b) {
+    return a < b ? a : b;
+}
+
+void streaming_transpose_mpi(MPI_Comm comm, float** matrix, float** result, int n, int rank, int size,
+                             size_t staging_bytes, long double* time, int verbosity) {
+    double start_time = mpi_phases_begin();
+    double mark = start_time;
+
+    if (n % size != 0) {
+        if (rank == 0) {
+            fprintf(stderr, "Matrix size n=%d is not divisible by number of processes size=%d.\n", n, size);
+        }
+        MPI_Abort(comm, EXIT_FAILURE);
+    }
+
+    int rows_per_proc = n / size;
+    MPI_Datatype row = mpi_row_type(n);
+    MPI_Datatype column = mpi_row_type(rows_per_proc);  // one row of a transposed block
+
+    // The staging buffer is split in two halves so that one is packed while the other is in flight.
+    // Chunk sizes only depend on the configuration, so both sides agree on them.
+    size_t half = staging_bytes / 2;
+    int chunk_rows = min_int(rows_per_proc, (int)(half / ((size_t)n * sizeof(float))));
+    int chunk_columns = min_int(n, (int)(half / ((size_t)rows_per_proc * sizeof(float))));
+    chunk_rows = chunk_rows > 0 ? chunk_rows : 1;
+    chunk_columns = chunk_columns > 0 ? chunk_columns : 1;
+
+    if (verbosity >= 2 && rank == 0) {
+        printf("Streaming with %d rows out and %d columns in per message\n", chunk_rows, chunk_columns);
+    }
+    mpi_phase_end(PHASE_SETUP, &mark);
+
+    if (rank == 0) {
+        size_t half_floats = (size_t)chunk_rows * n > (size_t)chunk_columns * rows_per_proc
+                           ? (size_t)chunk_rows * n : (size_t)chunk_columns * rows_per_proc;
+        float* staging = allocate_aligned(2 * half_floats * sizeof(float));
+        if (staging == NULL) {
+            fprintf(stderr, "Root Rank %d: Failed to allocate the staging buffer.\n", rank);
+            MPI_Abort(comm, EXIT_FAILURE);
+        }
+        float* buffers[2] = {staging, staging + half_floats};
+        MPI_Request requests[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+
+        // Rows are packed from the source rows of the other ranks, never from a flat copy
+        int b = 0;
+        for (int p = 1; p < size; p++) {
+            for (int r = 0; r < rows_per_proc; r += chunk_rows) {
+                int count = min_int(chunk_rows, rows_per_proc - r);
+                MPI_Wait(&requests[b], MPI_STATUS_IGNORE);
+                for (int k = 0; k < count; k++) {
+                    memcpy(&buffers[b][(size_t)k * n], matrix[p * rows_per_proc + r + k], n * sizeof(float));
+                }
+                MPI_Isend(buffers[b], count, row, p, TAG_STREAM_ROWS, comm, &requests[b]);
+                b ^= 1;
+            }
+        }
+        MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+        mpi_phase_end(PHASE_DISTRIBUTE, &mark);
+
+        // The root block goes straight from the source into the destination
+        for (int i = 0; i < rows_per_proc; i++) {
+            for (int j = 0; j < n; j++) {
+                result[j][i] = matrix[i][j];
+            }
+        }
+        mpi_phase_end(PHASE_COMPUTE, &mark);
+
+        // The next chunk is received into one half while the previous one is unpacked from the other
+        int chunks_per_rank = (n + chunk_columns - 1) / chunk_columns;
+        int total = (size - 1) * chunks_per_rank;
+        for (int c = 0; c <= total; c++) {
+            if (c < total) {
+                int p = 1 + c / chunks_per_rank;
+                int j = c % chunks_per_rank * chunk_columns;
+                MPI_Irecv(buffers[c & 1], min_int(chunk_columns, n - j), column, p, TAG_STREAM_COLUMNS, comm, &requests[c & 1]);
+            }
+            if (c > 0) {
+                int done = c - 1;
+                int p = 1 + done / chunks_per_rank;
+                int j = done % chunks_per_rank * chunk_columns;
+                int count = min_int(chunk_columns, n - j);
+                MPI_Wait(&requests[done & 1], MPI_STATUS_IGNORE);
+                for (int k = 0; k < count; k++) {
+                    memcpy(&result[j + k][p * rows_per_proc], &buffers[done & 1][(size_t)k * rows_per_proc],
+                           rows_per_proc * sizeof(float));
+                }
+            }
+        }
+        mpi_phase_end(PHASE_GATHER, &mark);
+
+        free(staging);
+    } else {
+        float* local_matrix = malloc((size_t)rows_per_proc * n * sizeof(float));
+        float* local_transposed = malloc((size_t)rows_per_proc * n * sizeof(float));
+        if (local_matrix == NULL || local_transposed == NULL) {
+            fprintf(stderr, "Rank %d: Failed to allocate the local blocks.\n", rank);
+            MPI_Abort(comm, EXIT_FAILURE);
+        }
+
+        for (int r = 0; r < rows_per_proc; r += chunk_rows) {
+            MPI_Recv(&local_matrix[(size_t)r * n], min_int(chunk_rows, rows_per_proc - r), row, 0,
+                     TAG_STREAM_ROWS, comm, MPI_STATUS_IGNORE);
+        }
+        mpi_phase_end(PHASE_DISTRIBUTE, &mark);
+
+        transpose_local(local_matrix, local_transposed, rows_per_proc, n);
+        mpi_phase_end(PHASE_COMPUTE, &mark);
+
+        for (int j = 0; j < n; j += chunk_columns) {
+            MPI_Send(&local_transposed[(size_t)j * rows_per_proc], min_int(chunk_columns, n - j), column, 0,
+                     TAG_STREAM_COLUMNS, comm);
+        }
+        mpi_phase_end(PHASE_GATHER, &mark);
+
+        free(local_matrix);
+        free(local_transposed);
+    }
+
+    MPI_Type_free(&row);
+    MPI_Type_free(&column);
+
+    *time = mpi_phases_finish(start_time);
+
+    if (verbosity >= 2) {
+        printf("Rank %d: streaming_transpose_mpi completed successfully\n", rank);
+        fflush(stdout);
+    }
+}
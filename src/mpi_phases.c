@@ -0,0 +1,40 @@
+#include "../include/mpi_phases.h"
+#include "../include/perf_counters.h"
+#include "../include/trace.h"
+#include <mpi.h>
+#include <string.h>
+
+const char* mpi_phase_names[NUM_MPI_PHASES] = {
+    "setup",
+    "flatten",
+    "distribute",
+    "compute",
+    "exchange",
+    "gather",
+    "rebuild"
+};
+
+static MPIPhaseTimes last;
+
+double mpi_phases_begin() {
+    memset(&last, 0, sizeof(last));
+    perf_counters_begin();
+    return MPI_Wtime();
+}
+
+void mpi_phase_end(MPIPhase phase, double* mark) {
+    double now = MPI_Wtime();
+    last.seconds[phase] += now - *mark;
+    TRACE_SPAN(mpi_phase_names[phase], now - *mark);
+    *mark = now;
+}
+
+double mpi_phases_finish(double start) {
+    last.total = MPI_Wtime() - start;
+    perf_counters_end();
+    return last.total;
+}
+
+const MPIPhaseTimes* mpi_phases_last() {
+    return &last;
+}
@@ -0,0 +1,351 @@
+#include "../include/mpi_plan.h"
+#include "../include/utils.h"
+#include "../include/mpi_phases.h"
+#include <mpi.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define TAG_SCATTER 100
+#define TAG_EXCHANGE 101
+#define TAG_GATHER 102
+
+const char* mpi_plan_algorithm_name(MPIPlanAlgorithm algorithm) {
+    switch (algorithm) {
+        case MPI_PLAN_ROW_BLOCK: return "row_block";
+        case MPI_PLAN_ALLTOALL: return "alltoall";
+        case MPI_PLAN_BLOCK_2D: return "block_2d";
+    }
+    return "unknown";
+}
+
+static float* plan_buffer(MPIPlan* plan, size_t count) {
+    float* buffer = allocate_aligned(count * sizeof(float));
+    if (buffer == NULL) {
+        fprintf(stderr, "Rank %d: Failed to allocate plan buffer of %zu floats.\n", plan->rank, count);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    return buffer;
+}
+
+static MPI_Request* plan_requests(MPIPlan* plan, int count) {
+    MPI_Request* requests = malloc(count * sizeof(MPI_Request));
+    if (requests == NULL) {
+        fprintf(stderr, "Rank %d: Failed to allocate plan requests.\n", plan->rank);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    return requests;
+}
+
+// Commits the datatype and keeps track of it so that destroy can free it
+static MPI_Datatype plan_type(MPIPlan* plan, MPI_Datatype type) {
+    MPI_Type_commit(&type);
+    plan->types[plan->num_types++] = type;
+    return type;
+}
+
+static MPI_Datatype contiguous_type(MPIPlan* plan, int count) {
+    MPI_Datatype type;
+    MPI_Type_contiguous(count, MPI_FLOAT, &type);
+    return plan_type(plan, type);
+}
+
+static MPI_Datatype strided_type(MPIPlan* plan, int count, int blocklength, int stride) {
+    MPI_Datatype type;
+    MPI_Type_vector(count, blocklength, stride, MPI_FLOAT, &type);
+    return plan_type(plan, type);
+}
+
+static MPI_Datatype subarray_type(MPIPlan* plan, int rows, int cols, int row_start, int col_start) {
+    MPI_Datatype type;
+    int n = plan->n;
+    MPI_Type_create_subarray(2, (int[]){n, n}, (int[]){rows, cols}, (int[]){row_start, col_start},
+                             MPI_ORDER_C, MPI_FLOAT, &type);
+    return plan_type(plan, type);
+}
+
+// Every rank receives a contiguous block of rows from the root
+static void init_row_scatter(MPIPlan* plan, MPI_Datatype row_type) {
+    int rows = plan->local_rows;
+
+    plan->num_scatter = plan->rank == 0 ? plan->size + 1 : 1;
+    plan->scatter_reqs = plan_requests(plan, plan->num_scatter);
+
+    MPI_Recv_init(plan->local, rows, row_type, 0, TAG_SCATTER, plan->comm, &plan->scatter_reqs[0]);
+    if (plan->rank == 0) {
+        for (int p = 0; p < plan->size; p++) {
+            MPI_Send_init(&plan->send_flat[(size_t)p * rows * plan->n], rows, row_type, p, TAG_SCATTER,
+                          plan->comm, &plan->scatter_reqs[p + 1]);
+        }
+    }
+}
+
+static void init_row_block(MPIPlan* plan) {
+    int n = plan->n;
+    int rows = n / plan->size;
+
+    plan->local_rows = rows;
+    plan->local_cols = n;
+    plan->local = plan_buffer(plan, (size_t)rows * n);
+    plan->local_t = plan_buffer(plan, (size_t)rows * n);
+
+    MPI_Datatype row_type = contiguous_type(plan, n);
+    init_row_scatter(plan, row_type);
+
+    // The local transpose is n x rows, which the root receives as a column block
+    MPI_Datatype column_type = contiguous_type(plan, rows);
+    MPI_Datatype column_block_type = strided_type(plan, n, rows, n);
+
+    plan->num_gather = plan->rank == 0 ? plan->size + 1 : 1;
+    plan->gather_reqs = plan_requests(plan, plan->num_gather);
+
+    MPI_Send_init(plan->local_t, n, column_type, 0, TAG_GATHER, plan->comm, &plan->gather_reqs[0]);
+    if (plan->rank == 0) {
+        for (int p = 0; p < plan->size; p++) {
+            MPI_Recv_init(&plan->recv_flat[(size_t)p * rows], 1, column_block_type, p, TAG_GATHER,
+                          plan->comm, &plan->gather_reqs[p + 1]);
+        }
+    }
+}
+
+static void init_alltoall(MPIPlan* plan) {
+    int n = plan->n;
+    int size = plan->size;
+    int rows = n / size;
+
+    plan->local_rows = rows;
+    plan->local_cols = n;
+    plan->local = plan_buffer(plan, (size_t)rows * n);
+    plan->local_t = plan_buffer(plan, (size_t)rows * n);
+    plan->exchange = plan_buffer(plan, (size_t)rows * n);
+
+    MPI_Datatype row_type = contiguous_type(plan, n);
+    init_row_scatter(plan, row_type);
+
+    // Square block q of the local rows goes to rank q, straight from the local buffer
+    MPI_Datatype square_type = strided_type(plan, rows, rows, n);
+    MPI_Datatype square_row_type = contiguous_type(plan, rows);
+
+    plan->num_exchange = 2 * size;
+    plan->exchange_reqs = plan_requests(plan, plan->num_exchange);
+    for (int q = 0; q < size; q++) {
+        MPI_Recv_init(&plan->exchange[(size_t)q * rows * rows], rows, square_row_type, q, TAG_EXCHANGE,
+                      plan->comm, &plan->exchange_reqs[q]);
+        MPI_Send_init(&plan->local[(size_t)q * rows], 1, square_type, q, TAG_EXCHANGE,
+                      plan->comm, &plan->exchange_reqs[size + q]);
+    }
+
+    // After the exchange each rank owns a block of rows of the transpose
+    plan->num_gather = plan->rank == 0 ? size + 1 : 1;
+    plan->gather_reqs = plan_requests(plan, plan->num_gather);
+
+    MPI_Send_init(plan->local_t, rows, row_type, 0, TAG_GATHER, plan->comm, &plan->gather_reqs[0]);
+    if (plan->rank == 0) {
+        for (int p = 0; p < size; p++) {
+            MPI_Recv_init(&plan->recv_flat[(size_t)p * rows * n], rows, row_type, p, TAG_GATHER,
+                          plan->comm, &plan->gather_reqs[p + 1]);
+        }
+    }
+}
+
+static int init_block_2d(MPIPlan* plan, MPI_Comm comm) {
+    int n = plan->n;
+    int size = plan->size;
+    int dims[2] = {0, 0};
+    int periods[2] = {0, 0};
+
+    MPI_Dims_create(size, 2, dims);
+    if (n % dims[0] != 0 || n % dims[1] != 0) {
+        if (plan->rank == 0) {
+            fprintf(stderr, "Matrix size n=%d must be divisible by grid dimensions %d x %d.\n", n, dims[0], dims[1]);
+        }
+        return 0;
+    }
+
+    // No reordering, so ranks in the grid match ranks in comm
+    MPI_Cart_create(comm, 2, dims, periods, 0, &plan->comm);
+
+    int block_rows = n / dims[0];
+    int block_cols = n / dims[1];
+
+    plan->local_rows = block_rows;
+    plan->local_cols = block_cols;
+    plan->local = plan_buffer(plan, (size_t)block_rows * block_cols);
+    plan->local_t = plan_buffer(plan, (size_t)block_rows * block_cols);
+
+    MPI_Datatype block_row_type = contiguous_type(plan, block_cols);
+    MPI_Datatype block_col_type = contiguous_type(plan, block_rows);
+
+    plan->num_scatter = plan->rank == 0 ? size + 1 : 1;
+    plan->num_gather = plan->num_scatter;
+    plan->scatter_reqs = plan_requests(plan, plan->num_scatter);
+    plan->gather_reqs = plan_requests(plan, plan->num_gather);
+
+    MPI_Recv_init(plan->local, block_rows, block_row_type, 0, TAG_SCATTER, plan->comm, &plan->scatter_reqs[0]);
+    MPI_Send_init(plan->local_t, block_cols, block_col_type, 0, TAG_GATHER, plan->comm, &plan->gather_reqs[0]);
+
+    if (plan->rank == 0) {
+        for (int p = 0; p < size; p++) {
+            int coords[2];
+            MPI_Cart_coords(plan->comm, p, 2, coords);
+
+            MPI_Datatype source_block = subarray_type(plan, block_rows, block_cols,
+                                                      coords[0] * block_rows, coords[1] * block_cols);
+            MPI_Datatype target_block = subarray_type(plan, block_cols, block_rows,
+                                                      coords[1] * block_cols, coords[0] * block_rows);
+
+            MPI_Send_init(plan->send_flat, 1, source_block, p, TAG_SCATTER, plan->comm, &plan->scatter_reqs[p + 1]);
+            MPI_Recv_init(plan->recv_flat, 1, target_block, p, TAG_GATHER, plan->comm, &plan->gather_reqs[p + 1]);
+        }
+    }
+
+    return 1;
+}
+
+MPIPlan* mpi_plan_create(MPI_Comm comm, int n, MPIPlanAlgorithm algorithm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    if (algorithm != MPI_PLAN_BLOCK_2D && (n % size != 0 || n < size)) {
+        if (rank == 0) {
+            fprintf(stderr, "Matrix size n=%d is not divisible by number of processes size=%d.\n", n, size);
+        }
+        return NULL;
+    }
+
+    MPIPlan* plan = calloc(1, sizeof(MPIPlan));
+    if (plan == NULL) {
+        fprintf(stderr, "Rank %d: Failed to allocate plan.\n", rank);
+        MPI_Abort(comm, EXIT_FAILURE);
+    }
+
+    plan->algorithm = algorithm;
+    plan->comm = MPI_COMM_NULL;
+    plan->n = n;
+    plan->rank = rank;
+    plan->size = size;
+
+    // Enough room for the per-rank subarray types of the 2D block plan
+    plan->types = malloc((2 * size + 4) * sizeof(MPI_Datatype));
+    if (plan->types == NULL) {
+        fprintf(stderr, "Rank %d: Failed to allocate plan datatypes.\n", rank);
+        MPI_Abort(comm, EXIT_FAILURE);
+    }
+
+    if (rank == 0) {
+        plan->send_flat = plan_buffer(plan, (size_t)n * n);
+        plan->recv_flat = plan_buffer(plan, (size_t)n * n);
+    }
+
+    if (algorithm == MPI_PLAN_BLOCK_2D) {
+        if (!init_block_2d(plan, comm)) {
+            mpi_plan_destroy(plan);
+            return NULL;
+        }
+    } else {
+        // A private communicator keeps the plan's messages apart from user traffic
+        MPI_Comm_dup(comm, &plan->comm);
+
+        if (algorithm == MPI_PLAN_ALLTOALL) {
+            init_alltoall(plan);
+        } else {
+            init_row_block(plan);
+        }
+    }
+
+    return plan;
+}
+
+void mpi_plan_execute(MPIPlan* plan, float** matrix, float** result, long double* time) {
+    double start_time = mpi_phases_begin();
+    double mark = start_time;
+
+    int n = plan->n;
+    int rows = plan->local_rows;
+    int cols = plan->local_cols;
+
+    if (plan->rank == 0) {
+        for (int i = 0; i < n; i++) {
+            memcpy(&plan->send_flat[(size_t)i * n], matrix[i], n * sizeof(float));
+        }
+    }
+    mpi_phase_end(PHASE_FLATTEN, &mark);
+
+    MPI_Startall(plan->num_scatter, plan->scatter_reqs);
+    MPI_Waitall(plan->num_scatter, plan->scatter_reqs, MPI_STATUSES_IGNORE);
+    mpi_phase_end(PHASE_DISTRIBUTE, &mark);
+
+    if (plan->algorithm == MPI_PLAN_ALLTOALL) {
+        MPI_Startall(plan->num_exchange, plan->exchange_reqs);
+        MPI_Waitall(plan->num_exchange, plan->exchange_reqs, MPI_STATUSES_IGNORE);
+        mpi_phase_end(PHASE_EXCHANGE, &mark);
+
+        // Block q holds rows of rank q restricted to our columns: transpose each into place
+        for (int q = 0; q < plan->size; q++) {
+            const float* block = &plan->exchange[(size_t)q * rows * rows];
+            for (int k = 0; k < rows; k++) {
+                for (int i = 0; i < rows; i++) {
+                    plan->local_t[(size_t)i * n + q * rows + k] = block[(size_t)k * rows + i];
+                }
+            }
+        }
+    } else {
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                plan->local_t[(size_t)j * rows + i] = plan->local[(size_t)i * cols + j];
+            }
+        }
+    }
+
+    mpi_phase_end(PHASE_COMPUTE, &mark);
+
+    MPI_Startall(plan->num_gather, plan->gather_reqs);
+    MPI_Waitall(plan->num_gather, plan->gather_reqs, MPI_STATUSES_IGNORE);
+    mpi_phase_end(PHASE_GATHER, &mark);
+
+    if (plan->rank == 0) {
+        for (int i = 0; i < n; i++) {
+            memcpy(result[i], &plan->recv_flat[(size_t)i * n], n * sizeof(float));
+        }
+    }
+    mpi_phase_end(PHASE_REBUILD, &mark);
+
+    *time = mpi_phases_finish(start_time);
+}
+
+static void free_requests(MPI_Request* requests, int count) {
+    if (requests == NULL) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        MPI_Request_free(&requests[i]);
+    }
+    free(requests);
+}
+
+void mpi_plan_destroy(MPIPlan* plan) {
+    if (plan == NULL) {
+        return;
+    }
+
+    free_requests(plan->scatter_reqs, plan->num_scatter);
+    free_requests(plan->exchange_reqs, plan->num_exchange);
+    free_requests(plan->gather_reqs, plan->num_gather);
+
+    for (int i = 0; i < plan->num_types; i++) {
+        MPI_Type_free(&plan->types[i]);
+    }
+    free(plan->types);
+
+    free(plan->send_flat);
+    free(plan->recv_flat);
+    free(plan->local);
+    free(plan->local_t);
+    free(plan->exchange);
+
+    if (plan->comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&plan->comm);
+    }
+    free(plan);
+}
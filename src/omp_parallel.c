@@ -1,11 +1,29 @@
+#include "../include/omp_parallel.h"
 #include "../include/config.h"
+#include "../include/perf_counters.h"
+#include "../include/tiles.h"
+#include "../include/thread_stats.h"
+#include "../include/trace.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
+// Interior tiles go to the compile-time instance for the tile size when there is one,
+// tiles cut by the matrix edge and sizes without an instance take the bounded path.
+// The prefetch distance is clamped so that it never reaches past the last source row.
+static inline void transpose_block(TileKernel tile, float** matrix, float** result, int i, int j, int size, int n,
+                                   int distance) {
+    if (tile != NULL && i + size <= n && j + size <= n) {
+        tile(matrix, result, i, j, distance < n - j - size ? distance : n - j - size);
+    } else {
+        transpose_tile(matrix, result, i, j, i + size > n ? n - i : size, j + size > n ? n - j : size);
+    }
+}
+
 bool is_symmetric_omp(float **matrix, int n, long double* time) {
     struct timespec start, end;
+    perf_counters_begin();
     clock_gettime(CLOCK_MONOTONIC, &start);
     bool is_symmetric = true;
 
@@ -25,6 +43,7 @@ bool is_symmetric_omp(float **matrix, int n, long double* time) {
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
@@ -48,18 +67,41 @@ float** transpose_omp(float **matrix, int n, long double* time) {
 
         #pragma omp single
         {
+            perf_counters_begin();
             clock_gettime(CLOCK_MONOTONIC, &start);
         }
 
-        #pragma omp for collapse(2) schedule(guided)
-        for (int i = 0; i < n; i++) {
-            for (int j = 0; j < n; j++) {
-                result[i][j] = matrix[j][i];
+        double region_start = thread_stats_begin();
+        long items = 0;
+
+        TRACE_BEGIN("omp_for");
+        // Every thread sees the same arming, so all of them take the same loop. The counting
+        // copy only runs under --thread-stats, and the timed baseline stays the plain one.
+        if (region_start != 0) {
+            #pragma omp for collapse(2) schedule(guided) nowait
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    result[i][j] = matrix[j][i];
+                    items++;
+                }
+            }
+        } else {
+            #pragma omp for collapse(2) schedule(guided) nowait
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    result[i][j] = matrix[j][i];
+                }
             }
         }
+        TRACE_END("omp_for");
+
+        thread_stats_busy(region_start, items);
+        #pragma omp barrier
+        thread_stats_end(region_start);
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
@@ -71,6 +113,8 @@ float** transpose_omp(float **matrix, int n, long double* time) {
 
 float** transpose_omp_block_based(float **matrix, int n, int block_size, long double* time) {
     struct timespec start, end;
+    TileKernel tile = tile_kernel(block_size);
+    int distance = get_config()->PREFETCH_DISTANCE;
 
     float **result = malloc(n * sizeof(float*));
     for (int i = 0; i < n; i++) {
@@ -81,22 +125,30 @@ float** transpose_omp_block_based(float **matrix, int n, int block_size, long do
     {
         #pragma omp single
         {
+            perf_counters_begin();
             clock_gettime(CLOCK_MONOTONIC, &start);
         }
 
-        #pragma omp for collapse(2) schedule(dynamic)
+        double region_start = thread_stats_begin();
+        long items = 0;
+
+        #pragma omp for collapse(2) schedule(dynamic) nowait
         for (int i = 0; i < n; i += block_size) {
             for (int j = 0; j < n; j += block_size) {
-                for (int ii = i; ii < i + block_size && ii < n; ii++) {
-                    for (int jj = j; jj < j + block_size && jj < n; jj++) {
-                        result[ii][jj] = matrix[jj][ii];
-                    }
-                }
+                TRACE_BEGIN("tile");
+                transpose_block(tile, matrix, result, i, j, block_size, n, distance);
+                TRACE_END("tile");
+                items++;
             }
         }
+
+        thread_stats_busy(region_start, items);
+        #pragma omp barrier
+        thread_stats_end(region_start);
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
@@ -115,28 +167,38 @@ float ** transpose_omp_tile_distributed(float **matrix, int n, int tile_size, lo
         result[i] = malloc(n * sizeof(float));
     }
 
-    int i, j, ii, jj;
+    TileKernel tile = tile_kernel(tile_size);
+    int distance = get_config()->PREFETCH_DISTANCE;
+    int i, j;
 
     #pragma omp parallel
     {
         #pragma omp single
         {
+            perf_counters_begin();
             clock_gettime(CLOCK_MONOTONIC, &start);
         }
 
-        #pragma omp for private(i,j,ii,jj) schedule(static)
+        double region_start = thread_stats_begin();
+        long items = 0;
+
+        #pragma omp for private(i,j) schedule(static) nowait
         for (i = 0; i < n; i += tile_size) {
             for (j = 0; j < n; j += tile_size) {
-                for (ii = i; ii < i + tile_size && ii < n; ii++) {
-                    for (jj = j; jj < j + tile_size && jj < n; jj++) {
-                        result[ii][jj] = matrix[jj][ii];
-                    }
-                }
+                TRACE_BEGIN("tile");
+                transpose_block(tile, matrix, result, i, j, tile_size, n, distance);
+                TRACE_END("tile");
+                items++;
             }
         }
+
+        thread_stats_busy(region_start, items);
+        #pragma omp barrier
+        thread_stats_end(region_start);
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
@@ -148,6 +210,8 @@ float ** transpose_omp_tile_distributed(float **matrix, int n, int tile_size, lo
 
 float ** transpose_omp_tasks(float **matrix, int n, int tile_size, long double* time) {
     struct timespec start, end;
+    TileKernel tile = tile_kernel(tile_size);
+    int distance = get_config()->PREFETCH_DISTANCE;
 
     float **result = malloc(n * sizeof(float*));
     for (int i = 0; i < n; i++) {
@@ -158,32 +222,36 @@ float ** transpose_omp_tasks(float **matrix, int n, int tile_size, long double*
 
     #pragma omp parallel
     {
+        double region_start = thread_stats_begin();
+
         #pragma omp single nowait
         {
+            perf_counters_begin();
             clock_gettime(CLOCK_MONOTONIC, &start);
 
             for (i = 0; i < n; i += tile_size) {
                 for (j = 0; j < n; j += tile_size) {
-                    #pragma omp task firstprivate(i, j) shared(matrix, result)
+                    #pragma omp task firstprivate(i, j) shared(matrix, result, tile, distance)
                     {
-                        int ii, jj;
-                        int max_ii = (i + tile_size > n) ? n : i + tile_size;
-                        int max_jj = (j + tile_size > n) ? n : j + tile_size;
-
-                        for (ii = i; ii < max_ii; ii++) {
-                            for (jj = j; jj < max_jj; jj++) {
-                                result[ii][jj] = matrix[jj][ii];
-                            }
-                        }
+                        TRACE_BEGIN("task");
+                        double task_start = thread_stats_begin();
+                        transpose_block(tile, matrix, result, i, j, tile_size, n, distance);
+                        thread_stats_busy(task_start, 1);
+                        TRACE_END("task");
                     }
                 }
             }
         }
 
         #pragma omp taskwait
+
+        // Threads run the remaining tasks at the barrier, so only the time after it is idle for sure
+        #pragma omp barrier
+        thread_stats_end(region_start);
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
@@ -193,15 +261,86 @@ float ** transpose_omp_tasks(float **matrix, int n, int tile_size, long double*
     return result;
 }
 
+// The tile of rows [i, max_i) and columns [j, max_j) against its mirror, j >= i. On the
+// diagonal only the elements above it are visited.
+static void symmetrize_tile_pair(float** matrix, int i, int j, int max_i, int max_j, SymmetrizeMode mode) {
+    for (int ii = i; ii < max_i; ii++) {
+        float* row = matrix[ii];
+        int first = i == j ? ii + 1 : j;
+        switch (mode) {
+            case SYMMETRIZE_AVERAGE:
+                for (int jj = first; jj < max_j; jj++) {
+                    row[jj] = matrix[jj][ii] = 0.5f * (row[jj] + matrix[jj][ii]);
+                }
+                break;
+            case SYMMETRIZE_UPPER_TO_LOWER:
+                for (int jj = first; jj < max_j; jj++) {
+                    matrix[jj][ii] = row[jj];
+                }
+                break;
+            case SYMMETRIZE_LOWER_TO_UPPER:
+                for (int jj = first; jj < max_j; jj++) {
+                    row[jj] = matrix[jj][ii];
+                }
+                break;
+        }
+    }
+}
+
+void symmetrize_omp(float **matrix, int n, int block_size, SymmetrizeMode mode, long double* time) {
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    #pragma omp parallel
+    {
+        double region_start = thread_stats_begin();
+        long items = 0;
+
+        // Same tile grid as transpose_omp_block_based, the pairs below the diagonal are skipped
+        #pragma omp for collapse(2) schedule(dynamic) nowait
+        for (int i = 0; i < n; i += block_size) {
+            for (int j = 0; j < n; j += block_size) {
+                if (j < i) {
+                    continue;
+                }
+                TRACE_BEGIN("tile_pair");
+                symmetrize_tile_pair(matrix, i, j, i + block_size > n ? n : i + block_size,
+                                     j + block_size > n ? n : j + block_size, mode);
+                TRACE_END("tile_pair");
+                items++;
+            }
+        }
+
+        thread_stats_busy(region_start, items);
+        #pragma omp barrier
+        thread_stats_end(region_start);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (get_config()->VERBOSE_LEVEL > 1) {
+        printf("Symmetrized the matrix (mode %d, block %d) using OMP in: %Lf\n", mode, block_size, *time);
+    }
+}
+
 void transpose_recursive(float** original, float** transposed, int start_row, int start_col, int size, int n) {
     Config* cfg = get_config();
     if (size <= cfg->BLOCK_SIZE) {
+        TRACE_BEGIN("task");
+        double tile_start = thread_stats_begin();
+
         // Base case: perform standard transposition
         for (int i = start_row; i < start_row + size; i++) {
             for (int j = start_col; j < start_col + size; j++) {
                 transposed[j][i] = original[i][j];
             }
         }
+
+        thread_stats_busy(tile_start, 1);
+        TRACE_END("task");
     } else {
         // Recursive case: divide the matrix into quadrants
         int half_size = size / 2;
@@ -240,12 +379,18 @@ float** transpose_cache_oblivious(float** matrix, int n, long double* time) {
 
     #pragma omp parallel
     {
+        double region_start = thread_stats_begin();
+
         #pragma omp single
         {
+            perf_counters_begin();
             clock_gettime(CLOCK_MONOTONIC, &start);
             transpose_recursive(matrix, transposed, 0, 0, n, n);
             clock_gettime(CLOCK_MONOTONIC, &end);
+            perf_counters_end();
         }
+
+        thread_stats_end(region_start);
     }
 
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
@@ -0,0 +1,187 @@
+#include "../include/omp_plan.h"
+#include "../include/perf_counters.h"
+#include "../include/thread_stats.h"
+#include "../include/trace.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+
+const char* omp_plan_strategy_name(OMPPlanStrategy strategy) {
+    switch (strategy) {
+        case OMP_PLAN_NAIVE: return "naive";
+        case OMP_PLAN_BLOCK_BASED: return "block_based";
+        case OMP_PLAN_TILE_DISTRIBUTED: return "tile_distributed";
+        case OMP_PLAN_TASKS: return "tasks";
+        case OMP_PLAN_IMPLICIT: return "implicit";
+        case OMP_PLAN_IMPLICIT_BLOCK_BASED: return "implicit_block_based";
+    }
+    return "unknown";
+}
+
+static int min_int(int a, int b) {
+    return a < b ? a : b;
+}
+
+// Owner of tile (ti, tj) on a grid of tiles_down x tiles_across tiles
+static int tile_owner(const OMPPlan* plan, int ti, int tj, int tiles_down, int tiles_across) {
+    int index = ti * tiles_across + tj;
+    int total = tiles_down * tiles_across;
+
+    switch (plan->strategy) {
+        case OMP_PLAN_TILE_DISTRIBUTED:
+            return ti % plan->threads;
+        case OMP_PLAN_TASKS:
+            return index % plan->threads;
+        default:
+            // Contiguous, balanced runs of tiles
+            return (int)(((long long)index * plan->threads) / total);
+    }
+}
+
+OMPPlan* omp_plan_create(int n, OMPPlanStrategy strategy, int tile_rows, int tile_cols, int threads) {
+    if (n <= 0 || tile_rows <= 0 || tile_cols <= 0 || threads <= 0) {
+        fprintf(stderr, "Invalid OMP plan arguments: n=%d tile=%dx%d threads=%d\n", n, tile_rows, tile_cols, threads);
+        return NULL;
+    }
+
+    OMPPlan* plan = calloc(1, sizeof(OMPPlan));
+    if (plan == NULL) {
+        fprintf(stderr, "Failed to allocate OMP plan.\n");
+        return NULL;
+    }
+
+    plan->strategy = strategy;
+    plan->n = n;
+    plan->threads = threads;
+
+    switch (strategy) {
+        case OMP_PLAN_NAIVE:
+            plan->tile_rows = 1;
+            plan->tile_cols = n;
+            break;
+        case OMP_PLAN_IMPLICIT:
+            plan->tile_rows = n;
+            plan->tile_cols = n;
+            plan->threads = 1;
+            break;
+        case OMP_PLAN_IMPLICIT_BLOCK_BASED:
+            plan->tile_rows = min_int(tile_rows, n);
+            plan->tile_cols = min_int(tile_cols, n);
+            plan->threads = 1;
+            break;
+        default:
+            plan->tile_rows = min_int(tile_rows, n);
+            plan->tile_cols = min_int(tile_cols, n);
+            break;
+    }
+
+    int tiles_down = (n + plan->tile_rows - 1) / plan->tile_rows;
+    int tiles_across = (n + plan->tile_cols - 1) / plan->tile_cols;
+    if ((long long)tiles_down * tiles_across > INT_MAX / 2) {
+        fprintf(stderr, "OMP plan of %d x %d tiles is too large, use larger tiles.\n", tiles_down, tiles_across);
+        omp_plan_destroy(plan);
+        return NULL;
+    }
+    plan->num_tiles = tiles_down * tiles_across;
+
+    plan->tiles = malloc(plan->num_tiles * sizeof(OMPPlanTile));
+    plan->thread_first = calloc(plan->threads + 1, sizeof(int));
+    if (plan->tiles == NULL || plan->thread_first == NULL) {
+        fprintf(stderr, "Failed to allocate OMP plan schedule.\n");
+        omp_plan_destroy(plan);
+        return NULL;
+    }
+
+    // Counting sort of the tiles by owner keeps each thread's tiles contiguous and in order
+    for (int ti = 0; ti < tiles_down; ti++) {
+        for (int tj = 0; tj < tiles_across; tj++) {
+            plan->thread_first[tile_owner(plan, ti, tj, tiles_down, tiles_across) + 1]++;
+        }
+    }
+    for (int t = 0; t < plan->threads; t++) {
+        plan->thread_first[t + 1] += plan->thread_first[t];
+    }
+
+    int* next = malloc(plan->threads * sizeof(int));
+    if (next == NULL) {
+        fprintf(stderr, "Failed to allocate OMP plan schedule.\n");
+        omp_plan_destroy(plan);
+        return NULL;
+    }
+    for (int t = 0; t < plan->threads; t++) {
+        next[t] = plan->thread_first[t];
+    }
+
+    for (int ti = 0; ti < tiles_down; ti++) {
+        for (int tj = 0; tj < tiles_across; tj++) {
+            int owner = tile_owner(plan, ti, tj, tiles_down, tiles_across);
+            OMPPlanTile* tile = &plan->tiles[next[owner]++];
+            tile->row_start = ti * plan->tile_rows;
+            tile->row_end = min_int(tile->row_start + plan->tile_rows, n);
+            tile->col_start = tj * plan->tile_cols;
+            tile->col_end = min_int(tile->col_start + plan->tile_cols, n);
+        }
+    }
+
+    free(next);
+    return plan;
+}
+
+// Bounds were clamped at plan creation, so the loops carry no edge checks
+static void run_tiles(const OMPPlan* plan, int thread, float** src, float** dst) {
+    for (int t = plan->thread_first[thread]; t < plan->thread_first[thread + 1]; t++) {
+        const OMPPlanTile tile = plan->tiles[t];
+        TRACE_BEGIN("tile");
+        for (int i = tile.row_start; i < tile.row_end; i++) {
+            float* out = dst[i];
+            #pragma GCC ivdep
+            for (int j = tile.col_start; j < tile.col_end; j++) {
+                out[j] = src[j][i];
+            }
+        }
+        TRACE_END("tile");
+    }
+}
+
+void omp_plan_execute(const OMPPlan* plan, float** src, float** dst, long double* time) {
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (plan->threads == 1) {
+        double region_start = thread_stats_begin();
+        run_tiles(plan, 0, src, dst);
+        thread_stats_busy(region_start, plan->num_tiles);
+    } else {
+        #pragma omp parallel num_threads(plan->threads)
+        {
+            double region_start = thread_stats_begin();
+            long items = 0;
+
+            // Covers the whole schedule even if the runtime grants fewer threads
+            for (int t = omp_get_thread_num(); t < plan->threads; t += omp_get_num_threads()) {
+                run_tiles(plan, t, src, dst);
+                items += plan->thread_first[t + 1] - plan->thread_first[t];
+            }
+
+            thread_stats_busy(region_start, items);
+            #pragma omp barrier
+            thread_stats_end(region_start);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void omp_plan_destroy(OMPPlan* plan) {
+    if (plan == NULL) {
+        return;
+    }
+    free(plan->tiles);
+    free(plan->thread_first);
+    free(plan);
+}
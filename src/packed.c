@@ -0,0 +1,256 @@
+#include "../include/packed.h"
+#include "../include/config.h"
+#include "../include/mpi_parallel.h"
+#include "../include/mpi_phases.h"
+#include "../include/perf_counters.h"
+#include "../include/thread_stats.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+PackedMatrix* packed_create(int n) {
+    PackedMatrix* packed = malloc(sizeof(PackedMatrix));
+    if (packed == NULL) {
+        return NULL;
+    }
+    packed->n = n;
+    packed->ld = n % 2 == 0 ? n + 1 : n;
+    packed->k = (n + 1) / 2;
+    packed->data = malloc((size_t)packed->ld * packed->k * sizeof(float));
+    if (packed->data == NULL) {
+        free(packed);
+        return NULL;
+    }
+    return packed;
+}
+
+void packed_destroy(PackedMatrix* packed) {
+    if (packed == NULL) {
+        return;
+    }
+    free(packed->data);
+    free(packed);
+}
+
+// Column j of the rectangle holds column j of the triangle from row j + even on, row i being
+// element (i - even, j); above it, row i holds (k + j - odd, k + i) of the bottom-right triangle.
+// Read from the upper triangle, the first part is a contiguous walk of row j and the second a
+// walk down a column, which the tiling keeps in cache.
+static void pack_tile(float** matrix, PackedMatrix* packed, int i0, int j0, int max_i, int max_j) {
+    int k = packed->k, odd = packed->n & 1, even = !odd;
+    for (int j = j0; j < max_j; j++) {
+        float* column = &packed->data[(size_t)j * packed->ld];
+        int split = j + even;
+        for (int i = i0; i < (split < max_i ? split : max_i); i++) {
+            column[i] = matrix[k + i][k + j - odd];
+        }
+        const float* row = matrix[j];
+        for (int i = split > i0 ? split : i0; i < max_i; i++) {
+            column[i] = row[i - even];
+        }
+    }
+}
+
+// Every element goes to both triangles. The tile is walked once by columns and once by rows,
+// so that the writes of both walks run along rows of the matrix.
+static void unpack_tile(const PackedMatrix* packed, float** matrix, int i0, int j0, int max_i, int max_j) {
+    int k = packed->k, ld = packed->ld, odd = packed->n & 1, even = !odd;
+    for (int j = j0; j < max_j; j++) {
+        const float* column = &packed->data[(size_t)j * ld];
+        int split = j + even;
+        float* upper = &matrix[k + j - odd][k];
+        for (int i = i0; i < (split < max_i ? split : max_i); i++) {
+            upper[i] = column[i];
+        }
+        float* row = matrix[j];
+        for (int i = split > i0 ? split : i0; i < max_i; i++) {
+            row[i - even] = column[i];
+        }
+    }
+    for (int i = i0; i < max_i; i++) {
+        const float* source = &packed->data[i];
+        // Columns up to i - even are in the lower part of the rectangle, the others above it
+        int split = i - even + 1;
+        float* lower = matrix[i - even < 0 ? 0 : i - even];
+        for (int j = j0; j < (split < max_j ? split : max_j); j++) {
+            lower[j] = source[(size_t)j * ld];
+        }
+        // Rows of the rectangle past n - k have no upper part
+        if (split < max_j) {
+            float* upper = &matrix[k + i][k - odd];
+            for (int j = split > j0 ? split : j0; j < max_j; j++) {
+                upper[j] = source[(size_t)j * ld];
+            }
+        }
+    }
+}
+
+// Tiles of the rectangle in parallel, with the per-thread statistics of the other kernels
+#define FOR_EACH_TILE(PACKED, BLOCK_SIZE, BODY)                                                 \
+    do {                                                                                        \
+        int ld_ = (PACKED)->ld, k_ = (PACKED)->k;                                               \
+        _Pragma("omp parallel")                                                                 \
+        {                                                                                       \
+            double region_start = thread_stats_begin();                                         \
+            long items = 0;                                                                     \
+            _Pragma("omp for collapse(2) schedule(static) nowait")                              \
+            for (int j = 0; j < k_; j += (BLOCK_SIZE)) {                                        \
+                for (int i = 0; i < ld_; i += (BLOCK_SIZE)) {                                   \
+                    int max_i = i + (BLOCK_SIZE) > ld_ ? ld_ : i + (BLOCK_SIZE);                \
+                    int max_j = j + (BLOCK_SIZE) > k_ ? k_ : j + (BLOCK_SIZE);                  \
+                    TRACE_BEGIN("tile");                                                        \
+                    BODY;                                                                       \
+                    TRACE_END("tile");                                                          \
+                    items++;                                                                    \
+                }                                                                               \
+            }                                                                                   \
+            thread_stats_busy(region_start, items);                                             \
+            _Pragma("omp barrier")                                                              \
+            thread_stats_end(region_start);                                                     \
+        }                                                                                       \
+    } while (0)
+
+void dense_to_packed_omp(float** matrix, PackedMatrix* packed, int block_size, long double* time) {
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    FOR_EACH_TILE(packed, block_size, pack_tile(matrix, packed, i, j, max_i, max_j));
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (get_config()->VERBOSE_LEVEL > 1) {
+        printf("Packed a %d x %d matrix into a %d x %d rectangle using OMP in: %Lf\n", packed->n, packed->n,
+               packed->ld, packed->k, *time);
+    }
+}
+
+void packed_to_dense_omp(const PackedMatrix* packed, float** matrix, int block_size, long double* time) {
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    FOR_EACH_TILE(packed, block_size, unpack_tile(packed, matrix, i, j, max_i, max_j));
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (get_config()->VERBOSE_LEVEL > 1) {
+        printf("Unpacked a %d x %d rectangle into a %d x %d matrix using OMP in: %Lf\n", packed->ld, packed->k,
+               packed->n, packed->n, *time);
+    }
+}
+
+#undef FOR_EACH_TILE
+
+// Counts and displacements in columns of the rectangle, the first k % size ranks get one more
+static void column_shares(int k, int size, int* counts, int* displs) {
+    int offset = 0;
+    for (int r = 0; r < size; r++) {
+        counts[r] = k / size + (r < k % size);
+        displs[r] = offset;
+        offset += counts[r];
+    }
+}
+
+PackedBlock* packed_scatter_mpi(MPI_Comm comm, const PackedMatrix* packed, int n, int rank, int size) {
+    int ld = n % 2 == 0 ? n + 1 : n;
+    int k = (n + 1) / 2;
+    int* counts = malloc(size * sizeof(int));
+    int* displs = malloc(size * sizeof(int));
+    PackedBlock* block = malloc(sizeof(PackedBlock));
+    if (counts == NULL || displs == NULL || block == NULL) {
+        fprintf(stderr, "Rank %d: Failed to allocate the packed block.\n", rank);
+        MPI_Abort(comm, EXIT_FAILURE);
+    }
+    column_shares(k, size, counts, displs);
+
+    block->n = n;
+    block->ld = ld;
+    block->first_col = displs[rank];
+    block->cols = counts[rank];
+    block->data = malloc(((size_t)ld * block->cols + 1) * sizeof(float));
+    if (block->data == NULL) {
+        fprintf(stderr, "Rank %d: Failed to allocate the packed block.\n", rank);
+        MPI_Abort(comm, EXIT_FAILURE);
+    }
+
+    MPI_Datatype column = mpi_row_type(ld);
+    MPI_Scatterv(rank == 0 ? packed->data : NULL, counts, displs, column, block->data, block->cols, column, 0, comm);
+    MPI_Type_free(&column);
+
+    free(counts);
+    free(displs);
+    return block;
+}
+
+void packed_gather_mpi(MPI_Comm comm, const PackedBlock* block, PackedMatrix* packed, int rank, int size) {
+    int k = (block->n + 1) / 2;
+    int* counts = malloc(size * sizeof(int));
+    int* displs = malloc(size * sizeof(int));
+    if (counts == NULL || displs == NULL) {
+        fprintf(stderr, "Rank %d: Failed to allocate the gather counts.\n", rank);
+        MPI_Abort(comm, EXIT_FAILURE);
+    }
+    column_shares(k, size, counts, displs);
+
+    MPI_Datatype column = mpi_row_type(block->ld);
+    MPI_Gatherv(block->data, block->cols, column, rank == 0 ? packed->data : NULL, counts, displs, column, 0, comm);
+    MPI_Type_free(&column);
+
+    free(counts);
+    free(displs);
+}
+
+void packed_block_destroy(PackedBlock* block) {
+    if (block == NULL) {
+        return;
+    }
+    free(block->data);
+    free(block);
+}
+
+void packed_scatter_gather_mpi(MPI_Comm comm, float** matrix, float** result, int n, int rank, int size,
+                               int block_size, long double* time, int verbosity) {
+    double start_time = mpi_phases_begin();
+    double mark = start_time;
+    long double local_time;
+
+    // The packed form takes the place of the flattened matrix of the other kernels
+    PackedMatrix* packed = NULL;
+    if (rank == 0) {
+        packed = packed_create(n);
+        if (packed == NULL) {
+            fprintf(stderr, "Rank %d: Failed to allocate the packed matrix.\n", rank);
+            MPI_Abort(comm, EXIT_FAILURE);
+        }
+        dense_to_packed_omp(matrix, packed, block_size, &local_time);
+    }
+    mpi_phase_end(PHASE_FLATTEN, &mark);
+
+    PackedBlock* block = packed_scatter_mpi(comm, packed, n, rank, size);
+    mpi_phase_end(PHASE_DISTRIBUTE, &mark);
+
+    if (verbosity >= 2) {
+        printf("Rank %d: Holding columns %d to %d of the %d x %d rectangle\n", rank, block->first_col,
+               block->first_col + block->cols, block->ld, (n + 1) / 2);
+        fflush(stdout);
+    }
+
+    packed_gather_mpi(comm, block, packed, rank, size);
+    mpi_phase_end(PHASE_GATHER, &mark);
+
+    if (rank == 0) {
+        packed_to_dense_omp(packed, result, block_size, &local_time);
+    }
+    mpi_phase_end(PHASE_REBUILD, &mark);
+
+    packed_block_destroy(block);
+    packed_destroy(packed);
+
+    *time = mpi_phases_finish(start_time);
+}
@@ -0,0 +1,195 @@
+#include "../include/perf_counters.h"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+const char* perf_event_names[PERF_NUM_EVENTS] = {
+    "cycles",
+    "instructions",
+    "llc_misses",
+    "dtlb_misses",
+    "stalled_cycles_backend"
+};
+
+static int* fds = NULL;
+static int num_threads = 0;
+static int event_open[PERF_NUM_EVENTS];
+// Set between perf_counters_arm and perf_counters_disarm, with the open timed regions
+static int armed = 0;
+static int depth = 0;
+
+static void event_attr(PerfEvent event, struct perf_event_attr* attr) {
+    memset(attr, 0, sizeof(*attr));
+    attr->size = sizeof(*attr);
+    attr->disabled = 1;
+    attr->exclude_kernel = 1;
+    attr->exclude_hv = 1;
+    attr->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (event) {
+        case PERF_CYCLES:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_INSTRUCTIONS:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_LLC_MISSES:
+            attr->type = PERF_TYPE_HW_CACHE;
+            attr->config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_DTLB_MISSES:
+            attr->type = PERF_TYPE_HW_CACHE;
+            attr->config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_STALLED_BACKEND:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_STALLED_CYCLES_BACKEND;
+            break;
+        default:
+            break;
+    }
+}
+
+// pid 0 and cpu -1 count the calling thread on whichever CPU it runs
+static int open_event(PerfEvent event) {
+    struct perf_event_attr attr;
+    event_attr(event, &attr);
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int perf_counters_open(int threads) {
+    static int warned = 0;
+
+    perf_counters_close();
+
+    fds = malloc(threads * PERF_NUM_EVENTS * sizeof(int));
+    if (fds == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < threads * PERF_NUM_EVENTS; i++) {
+        fds[i] = -1;
+    }
+
+    // Each thread has to open its own counters, so the team is entered once to do so.
+    // OpenMP keeps the same threads for the following regions of the same size. The
+    // runtime may grant fewer threads (OMP_THREAD_LIMIT, dynamic teams) than asked for.
+    #pragma omp parallel num_threads(threads)
+    {
+        int t = omp_get_thread_num();
+        for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+            fds[t * PERF_NUM_EVENTS + e] = open_event(e);
+        }
+        #pragma omp single
+        num_threads = omp_get_num_threads();
+    }
+
+    int opened = 0;
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        event_open[e] = 1;
+        for (int t = 0; t < num_threads; t++) {
+            if (fds[t * PERF_NUM_EVENTS + e] < 0) {
+                event_open[e] = 0;
+            }
+        }
+        opened += event_open[e];
+    }
+
+    if (opened == 0 && !warned) {
+        fprintf(stderr, "Warning: hardware performance counters are not available (check /proc/sys/kernel/perf_event_paranoid), skipping them\n");
+        warned = 1;
+    }
+
+    return opened;
+}
+
+static void for_each_fd(unsigned long request) {
+    for (int i = 0; i < num_threads * PERF_NUM_EVENTS; i++) {
+        if (fds[i] >= 0) {
+            ioctl(fds[i], request, 0);
+        }
+    }
+}
+
+void perf_counters_arm() {
+    if (fds == NULL) {
+        return;
+    }
+    for_each_fd(PERF_EVENT_IOC_RESET);
+    armed = 1;
+    depth = 0;
+}
+
+void perf_counters_begin() {
+    if (armed && depth++ == 0) {
+        for_each_fd(PERF_EVENT_IOC_ENABLE);
+    }
+}
+
+void perf_counters_end() {
+    if (armed && depth > 0 && --depth == 0) {
+        for_each_fd(PERF_EVENT_IOC_DISABLE);
+    }
+}
+
+void perf_counters_disarm(PerfCounts* counts) {
+    if (fds == NULL) {
+        return;
+    }
+    if (depth > 0) {
+        for_each_fd(PERF_EVENT_IOC_DISABLE);
+    }
+    armed = 0;
+    depth = 0;
+
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (!event_open[e]) {
+            counts->available[e] = 0;
+            continue;
+        }
+
+        for (int t = 0; t < num_threads; t++) {
+            // value, time enabled, time running
+            uint64_t data[3];
+            if (read(fds[t * PERF_NUM_EVENTS + e], data, sizeof(data)) != sizeof(data)) {
+                counts->available[e] = 0;
+                continue;
+            }
+
+            // Scale up if the kernel had to multiplex the counter
+            double value = (double)data[0];
+            if (data[2] > 0 && data[2] < data[1]) {
+                value *= (double)data[1] / data[2];
+            }
+            counts->values[e] += (long long)value;
+        }
+    }
+}
+
+void perf_counters_close() {
+    if (fds == NULL) {
+        return;
+    }
+    for (int i = 0; i < num_threads * PERF_NUM_EVENTS; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+    free(fds);
+    fds = NULL;
+    num_threads = 0;
+}
+
+void perf_counts_clear(PerfCounts* counts) {
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        counts->values[e] = 0;
+        counts->available[e] = 1;
+    }
+}
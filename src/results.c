@@ -0,0 +1,160 @@
+#define _GNU_SOURCE
+#include "../include/results.h"
+#include "../include/config.h"
+#include "../include/autotune.h"
+#include "../include/perf_counters.h"
+#include "../include/mpi_phases.h"
+#include "../include/affinity.h"
+#include <errno.h>
+#include <mpi.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Filled in by the Makefile, which rebuilds this file on every build so that they stay current
+#ifndef PARCO_COMMIT
+#define PARCO_COMMIT "unknown"
+#endif
+#ifndef PARCO_CFLAGS
+#define PARCO_CFLAGS "unknown"
+#endif
+
+static char run_results_path[1024] = "";
+
+void write_results_header(FILE* fp) {
+    fprintf(fp, "matrix_dimension,threads,block_size,time,func_name,call_time,min,median,p90,p99,stddev,ci95");
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        fprintf(fp, ",%s", perf_event_names[e]);
+    }
+    fprintf(fp, ",effective_gbps,pct_peak");
+    for (int p = 0; p < NUM_MPI_PHASES; p++) {
+        fprintf(fp, ",%s_max,%s_min,%s_mean", mpi_phase_names[p], mpi_phase_names[p], mpi_phase_names[p]);
+    }
+    fprintf(fp, ",imbalance,idle_pct,bind,placement,peak_rss_mb,rank_rss_mb,prefetch_distance,density\n");
+}
+
+// CPUs this process may run on, as a list of ranges such as 0-3,8
+static void write_affinity(FILE* fp) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        fprintf(fp, "unknown");
+        return;
+    }
+
+    int first = 1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &set)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) {
+            last++;
+        }
+        fprintf(fp, first ? "%d" : ",%d", cpu);
+        if (last > cpu) {
+            fprintf(fp, "-%d", last);
+        }
+        first = 0;
+        cpu = last;
+    }
+}
+
+static const char* env_or_unset(const char* name) {
+    const char* value = getenv(name);
+    return value != NULL ? value : "unset";
+}
+
+void write_run_metadata(FILE* fp, int argc, char* argv[]) {
+    Config* cfg = get_config();
+
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+
+    char date[64];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    // Only the first line of the library version, the rest is build configuration
+    char library[MPI_MAX_LIBRARY_VERSION_STRING];
+    int library_length;
+    MPI_Get_library_version(library, &library_length);
+    library[strcspn(library, "\n")] = '\0';
+
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    fprintf(fp, "# commit: %s\n", PARCO_COMMIT);
+    fprintf(fp, "# cflags: %s\n", PARCO_CFLAGS);
+    fprintf(fp, "# compiler: %s\n", __VERSION__);
+    fprintf(fp, "# mpi_library: %s\n", library);
+    fprintf(fp, "# date: %s\n", date);
+    fprintf(fp, "# host: %s\n", host);
+    fprintf(fp, "# cpu_model: %s\n", autotune_cpu_model());
+    fprintf(fp, "# online_cpus: %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(fp, "# mpi_ranks: %d\n", ranks);
+    fprintf(fp, "# affinity: ");
+    write_affinity(fp);
+    fprintf(fp, "\n");
+    fprintf(fp, "# omp_proc_bind: %s\n", env_or_unset("OMP_PROC_BIND"));
+    fprintf(fp, "# omp_places: %s\n", env_or_unset("OMP_PLACES"));
+    fprintf(fp, "# omp_num_threads: %s\n", env_or_unset("OMP_NUM_THREADS"));
+    fprintf(fp, "# bind: %s\n", bind_policy_name(cfg->BIND_POLICY));
+    fprintf(fp, "# runs: %d\n", cfg->NUM_RUNS);
+    fprintf(fp, "# warmup: %d\n", cfg->WARMUP_RUNS);
+
+    fprintf(fp, "# command:");
+    for (int i = 0; i < argc; i++) {
+        fprintf(fp, " %s", argv[i]);
+    }
+    fprintf(fp, "\n");
+}
+
+const char* create_run_results(const char* dir, int argc, char* argv[]) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Failed to create results directory %s\n", dir);
+        return NULL;
+    }
+
+    char host[64] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    host[strcspn(host, ".")] = '\0';
+
+    char stamp[32];
+    time_t now = time(NULL);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+    // The pid keeps two runs started in the same second apart
+    snprintf(run_results_path, sizeof(run_results_path), "%s/benchmark_%s_%s_%d.csv", dir, stamp, host, (int)getpid());
+
+    FILE* fp = fopen(run_results_path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open results file %s\n", run_results_path);
+        run_results_path[0] = '\0';
+        return NULL;
+    }
+
+    write_run_metadata(fp, argc, argv);
+    write_results_header(fp);
+    fclose(fp);
+
+    return run_results_path;
+}
+
+static void append_to(const char* path, const char* row) {
+    FILE* fp = fopen(path, "a");
+    if (fp == NULL) {
+        return;
+    }
+    fputs(row, fp);
+    fclose(fp);
+}
+
+void append_result_row(const char* row) {
+    append_to("benchmark_results.csv", row);
+    if (run_results_path[0] != '\0') {
+        append_to(run_results_path, row);
+    }
+}
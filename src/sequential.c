@@ -1,4 +1,5 @@
 #include "../include/config.h"
+#include "../include/perf_counters.h"
 #include "../include/sequential.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,6 +7,7 @@
 
 bool is_symmetric_sequential(float **matrix, int n, long double* time) {
     struct timespec start, end;
+    perf_counters_begin();
     clock_gettime(CLOCK_MONOTONIC, &start);
 
     for (int i = 0; i < n; i++) {
@@ -14,6 +16,7 @@ bool is_symmetric_sequential(float **matrix, int n, long double* time) {
         for (int j = 0; j < i; j++) {
             if (matrix[i][j] != matrix[j][i]) {
                 clock_gettime(CLOCK_MONOTONIC, &end);
+                perf_counters_end();
                 *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
                 if (get_config()->VERBOSE_LEVEL > 1) {
@@ -26,6 +29,7 @@ bool is_symmetric_sequential(float **matrix, int n, long double* time) {
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
@@ -43,6 +47,7 @@ float** transpose_sequential(float **matrix, int n, long double* time) {
     }
 
     struct timespec start, end;
+    perf_counters_begin();
     clock_gettime(CLOCK_MONOTONIC, &start);
 
     for (int i = 0; i < n; i++) {
@@ -52,6 +57,7 @@ float** transpose_sequential(float **matrix, int n, long double* time) {
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
     *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
     if (get_config()->VERBOSE_LEVEL > 1) {
@@ -0,0 +1,416 @@
+#include "../include/sparse.h"
+#include "../include/config.h"
+#include "../include/perf_counters.h"
+#include "../include/thread_stats.h"
+#include "../include/trace.h"
+#include <math.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+CSRMatrix* csr_create(int rows, int cols, long long nnz) {
+    CSRMatrix* matrix = malloc(sizeof(CSRMatrix));
+    if (matrix == NULL) {
+        return NULL;
+    }
+    matrix->rows = rows;
+    matrix->cols = cols;
+    matrix->nnz = nnz;
+    matrix->row_ptr = malloc(((size_t)rows + 1) * sizeof(long long));
+    matrix->col_idx = malloc((nnz > 0 ? (size_t)nnz : 1) * sizeof(int));
+    matrix->values = malloc((nnz > 0 ? (size_t)nnz : 1) * sizeof(float));
+    if (matrix->row_ptr == NULL || matrix->col_idx == NULL || matrix->values == NULL) {
+        csr_destroy(matrix);
+        return NULL;
+    }
+    return matrix;
+}
+
+void csr_destroy(CSRMatrix* matrix) {
+    if (matrix == NULL) {
+        return;
+    }
+    free(matrix->row_ptr);
+    free(matrix->col_idx);
+    free(matrix->values);
+    free(matrix);
+}
+
+// Exclusive prefix sum of counts[0..rows) into row_ptr, returns the total
+static long long prefix_rows(const long long* counts, long long* row_ptr, int rows) {
+    long long total = 0;
+    for (int i = 0; i < rows; i++) {
+        row_ptr[i] = total;
+        total += counts[i];
+    }
+    row_ptr[rows] = total;
+    return total;
+}
+
+CSRMatrix* csr_from_dense_omp(float** matrix, int rows, int cols, long double* time) {
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    long long* counts = malloc(((size_t)rows + 1) * sizeof(long long));
+    if (counts == NULL) {
+        return NULL;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < rows; i++) {
+        long long count = 0;
+        for (int j = 0; j < cols; j++) {
+            count += matrix[i][j] != 0.0f;
+        }
+        counts[i] = count;
+    }
+
+    long long nnz = 0;
+    for (int i = 0; i < rows; i++) {
+        nnz += counts[i];
+    }
+    CSRMatrix* sparse = csr_create(rows, cols, nnz);
+    if (sparse == NULL) {
+        free(counts);
+        return NULL;
+    }
+    prefix_rows(counts, sparse->row_ptr, rows);
+    free(counts);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < rows; i++) {
+        long long k = sparse->row_ptr[i];
+        for (int j = 0; j < cols; j++) {
+            if (matrix[i][j] != 0.0f) {
+                sparse->col_idx[k] = j;
+                sparse->values[k] = matrix[i][j];
+                k++;
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (get_config()->VERBOSE_LEVEL > 1) {
+        printf("Compressed a %d x %d matrix into %lld CSR entries using OMP in: %Lf\n", rows, cols, nnz, *time);
+    }
+    return sparse;
+}
+
+float** csr_to_dense(const CSRMatrix* matrix) {
+    float** dense = malloc(matrix->rows * sizeof(float*));
+    if (dense == NULL) {
+        return NULL;
+    }
+
+    int failed = 0;
+    #pragma omp parallel for schedule(static) reduction(||:failed)
+    for (int i = 0; i < matrix->rows; i++) {
+        dense[i] = calloc(matrix->cols, sizeof(float));
+        if (dense[i] == NULL) {
+            failed = 1;
+            continue;
+        }
+        for (long long k = matrix->row_ptr[i]; k < matrix->row_ptr[i + 1]; k++) {
+            dense[i][matrix->col_idx[k]] = matrix->values[k];
+        }
+    }
+
+    if (failed) {
+        for (int i = 0; i < matrix->rows; i++) {
+            free(dense[i]);
+        }
+        free(dense);
+        return NULL;
+    }
+    return dense;
+}
+
+// Columns after the diagonal drawn as Bernoulli(density) by geometric gaps, so a row costs
+// its entries and not n. Called twice per row with the same seed, to count and then to fill.
+static long long random_upper_row(int n, int i, double density, unsigned int seed, int* col_idx, float* values) {
+    unsigned int state = seed;
+    long long count = 0;
+    double skip = density < 1.0 ? 1.0 / log1p(-density) : 0.0;
+    for (long long j = i;; count++) {
+        if (count > 0) {
+            double u = (rand_r(&state) + 1.0) / ((double)RAND_MAX + 2.0);
+            double gap = density < 1.0 ? floor(log(u) * skip) : 0.0;
+            if (gap >= n - j) {
+                break;
+            }
+            j += 1 + (long long)gap;
+        }
+        if (j >= n) {
+            break;
+        }
+        float value = 1.0f + (float)(rand_r(&state) % 1000) / 100.0f;
+        if (col_idx != NULL) {
+            col_idx[count] = (int)j;
+            values[count] = value;
+        }
+    }
+    return count;
+}
+
+CSRMatrix* csr_random_symmetric(int n, double density, unsigned int seed) {
+    long long* counts = malloc(((size_t)n + 1) * sizeof(long long));
+    if (counts == NULL) {
+        return NULL;
+    }
+
+    // Upper triangle with the diagonal
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < n; i++) {
+        counts[i] = random_upper_row(n, i, density, seed + i, NULL, NULL);
+    }
+    long long upper_nnz = 0;
+    for (int i = 0; i < n; i++) {
+        upper_nnz += counts[i];
+    }
+    CSRMatrix* upper = csr_create(n, n, upper_nnz);
+    if (upper == NULL) {
+        free(counts);
+        return NULL;
+    }
+    prefix_rows(counts, upper->row_ptr, n);
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < n; i++) {
+        long long k = upper->row_ptr[i];
+        random_upper_row(n, i, density, seed + i, &upper->col_idx[k], &upper->values[k]);
+    }
+
+    // Row i is the strictly lower part of column i of the upper triangle, then row i of it
+    long double time;
+    CSRMatrix* lower = csr_transpose_omp(upper, &time);
+    if (lower == NULL) {
+        csr_destroy(upper);
+        free(counts);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        counts[i] = (lower->row_ptr[i + 1] - lower->row_ptr[i] - 1) + (upper->row_ptr[i + 1] - upper->row_ptr[i]);
+    }
+    CSRMatrix* matrix = csr_create(n, n, 2 * upper_nnz - n);
+    if (matrix != NULL) {
+        prefix_rows(counts, matrix->row_ptr, n);
+
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int i = 0; i < n; i++) {
+            long long k = matrix->row_ptr[i];
+            long long below = lower->row_ptr[i + 1] - lower->row_ptr[i] - 1;
+            long long above = upper->row_ptr[i + 1] - upper->row_ptr[i];
+            memcpy(&matrix->col_idx[k], &lower->col_idx[lower->row_ptr[i]], below * sizeof(int));
+            memcpy(&matrix->values[k], &lower->values[lower->row_ptr[i]], below * sizeof(float));
+            memcpy(&matrix->col_idx[k + below], &upper->col_idx[upper->row_ptr[i]], above * sizeof(int));
+            memcpy(&matrix->values[k + below], &upper->values[upper->row_ptr[i]], above * sizeof(float));
+        }
+    }
+
+    csr_destroy(lower);
+    csr_destroy(upper);
+    free(counts);
+    return matrix;
+}
+
+// First row of thread t when the entries are split evenly, rows are never split
+static int first_row(const CSRMatrix* matrix, int t, int threads) {
+    long long target = matrix->nnz * t / threads;
+    int lo = 0, hi = matrix->rows;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (matrix->row_ptr[mid] < target) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return t == 0 ? 0 : lo;
+}
+
+CSRMatrix* csr_transpose_omp(const CSRMatrix* matrix, long double* time) {
+    int rows = matrix->rows, cols = matrix->cols;
+    int max_threads = omp_get_max_threads();
+
+    CSRMatrix* result = csr_create(cols, rows, matrix->nnz);
+    // offsets[t * cols + c]: entries of column c in the rows of thread t, then where they go
+    long long* offsets = malloc((size_t)max_threads * cols * sizeof(long long));
+    long long* chunk_sums = malloc(((size_t)max_threads + 1) * sizeof(long long));
+    if (result == NULL || offsets == NULL || chunk_sums == NULL) {
+        csr_destroy(result);
+        free(offsets);
+        free(chunk_sums);
+        return NULL;
+    }
+
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    #pragma omp parallel
+    {
+        double region_start = thread_stats_begin();
+        int threads = omp_get_num_threads();
+        int t = omp_get_thread_num();
+        int row_begin = first_row(matrix, t, threads);
+        int row_end = t + 1 == threads ? rows : first_row(matrix, t + 1, threads);
+        int col_begin = (int)((long long)cols * t / threads);
+        int col_end = (int)((long long)cols * (t + 1) / threads);
+        long long* own = &offsets[(size_t)t * cols];
+
+        TRACE_BEGIN("histogram");
+        memset(own, 0, cols * sizeof(long long));
+        for (long long k = matrix->row_ptr[row_begin]; k < matrix->row_ptr[row_end]; k++) {
+            own[matrix->col_idx[k]]++;
+        }
+        TRACE_END("histogram");
+        #pragma omp barrier
+
+        // Prefix sum over (column, thread) in column-major order: every thread scans its own
+        // columns, the chunk totals are scanned once, then added back
+        TRACE_BEGIN("prefix_sum");
+        long long running = 0;
+        for (int c = col_begin; c < col_end; c++) {
+            for (int s = 0; s < threads; s++) {
+                long long count = offsets[(size_t)s * cols + c];
+                offsets[(size_t)s * cols + c] = running;
+                running += count;
+            }
+        }
+        chunk_sums[t + 1] = running;
+        #pragma omp barrier
+        #pragma omp single
+        {
+            chunk_sums[0] = 0;
+            for (int s = 1; s <= threads; s++) {
+                chunk_sums[s] += chunk_sums[s - 1];
+            }
+        }
+        for (int c = col_begin; c < col_end; c++) {
+            for (int s = 0; s < threads; s++) {
+                offsets[(size_t)s * cols + c] += chunk_sums[t];
+            }
+            result->row_ptr[c] = offsets[c];
+        }
+        TRACE_END("prefix_sum");
+        #pragma omp barrier
+
+        TRACE_BEGIN("scatter");
+        for (int i = row_begin; i < row_end; i++) {
+            for (long long k = matrix->row_ptr[i]; k < matrix->row_ptr[i + 1]; k++) {
+                long long p = own[matrix->col_idx[k]]++;
+                result->col_idx[p] = i;
+                result->values[p] = matrix->values[k];
+            }
+        }
+        TRACE_END("scatter");
+
+        thread_stats_busy(region_start, row_end - row_begin);
+        #pragma omp barrier
+        thread_stats_end(region_start);
+    }
+    result->row_ptr[cols] = matrix->nnz;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    free(offsets);
+    free(chunk_sums);
+
+    if (get_config()->VERBOSE_LEVEL > 1) {
+        printf("Transposed a %d x %d CSR matrix with %lld entries using OMP in: %Lf\n", rows, cols, matrix->nnz, *time);
+    }
+    return result;
+}
+
+// Index of column col in row i, -1 when not stored
+static long long find_entry(const CSRMatrix* matrix, int i, int col) {
+    long long lo = matrix->row_ptr[i], hi = matrix->row_ptr[i + 1];
+    while (lo < hi) {
+        long long mid = lo + (hi - lo) / 2;
+        if (matrix->col_idx[mid] < col) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < matrix->row_ptr[i + 1] && matrix->col_idx[lo] == col ? lo : -1;
+}
+
+SparseSymmetry csr_is_symmetric_omp(const CSRMatrix* matrix, long double* time) {
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int structural = matrix->rows == matrix->cols;
+    int numerical = structural;
+
+    if (structural) {
+        long long below = 0, above = 0;
+
+        #pragma omp parallel reduction(&&:numerical) reduction(+:below, above)
+        {
+            double region_start = thread_stats_begin();
+            long items = 0;
+
+            // Only the pairs with i < j are looked up, the others are their mirrors
+            #pragma omp for schedule(dynamic, 64) nowait
+            for (int i = 0; i < matrix->rows; i++) {
+                int still_structural;
+                #pragma omp atomic read
+                still_structural = structural;
+                if (!still_structural) {
+                    continue;
+                }
+                for (long long k = matrix->row_ptr[i]; k < matrix->row_ptr[i + 1]; k++) {
+                    int j = matrix->col_idx[k];
+                    if (j < i) {
+                        below++;
+                        continue;
+                    }
+                    if (j == i) {
+                        continue;
+                    }
+                    above++;
+                    long long mirror = find_entry(matrix, j, i);
+                    if (mirror < 0) {
+                        #pragma omp atomic write
+                        structural = 0;
+                        break;
+                    }
+                    numerical = numerical && matrix->values[mirror] == matrix->values[k];
+                }
+                items++;
+            }
+
+            thread_stats_busy(region_start, items);
+            #pragma omp barrier
+            thread_stats_end(region_start);
+        }
+
+        // Every entry above the diagonal was found mirrored below it, so the mirrors cover the
+        // entries below the diagonal exactly when there are as many of them
+        structural = structural && below == above;
+    }
+
+    SparseSymmetry symmetry = !structural ? SPARSE_ASYMMETRIC
+                              : numerical ? SPARSE_SYMMETRIC : SPARSE_STRUCTURALLY_SYMMETRIC;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (get_config()->VERBOSE_LEVEL > 1) {
+        const char* names[] = {"not symmetric", "structurally symmetric", "symmetric"};
+        printf("Computed that the CSR matrix with %lld entries is %s using OMP in: %Lf\n", matrix->nnz,
+               names[symmetry], *time);
+    }
+    return symmetry;
+}
@@ -0,0 +1,99 @@
+#include "../include/stream.h"
+#include "../include/utils.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define MAX_STREAM_RESULTS 64
+
+static StreamResult results[MAX_STREAM_RESULTS];
+static int num_results = 0;
+
+const StreamResult* stream_result(int threads) {
+    for (int i = 0; i < num_results; i++) {
+        if (results[i].threads == threads) {
+            return &results[i];
+        }
+    }
+    return NULL;
+}
+
+const StreamResult* stream_calibrate(int threads) {
+    const StreamResult* cached = stream_result(threads);
+    if (cached != NULL) {
+        return cached;
+    }
+    if (num_results == MAX_STREAM_RESULTS) {
+        return NULL;
+    }
+
+    // Each array at least four times the last level cache, as the reference STREAM requires
+    long llc_size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (llc_size <= 0) {
+        llc_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    }
+    long n = STREAM_MIN_ARRAY_SIZE;
+    if (llc_size > 0 && 4 * llc_size / (long)sizeof(double) > n) {
+        n = 4 * llc_size / sizeof(double);
+    }
+    const double scalar = 3.0;
+
+    double* a = allocate_aligned(n * sizeof(double));
+    double* b = allocate_aligned(n * sizeof(double));
+    double* c = allocate_aligned(n * sizeof(double));
+    if (a == NULL || b == NULL || c == NULL) {
+        fprintf(stderr, "Failed to allocate the STREAM arrays\n");
+        free(a);
+        free(b);
+        free(c);
+        return NULL;
+    }
+
+    // First touch with the same static schedule places the pages next to the threads using them
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (long i = 0; i < n; i++) {
+        a[i] = 1.0;
+        b[i] = 2.0;
+        c[i] = 0.0;
+    }
+
+    double best_copy = -1;
+    double best_triad = -1;
+    for (int r = 0; r < STREAM_REPETITIONS; r++) {
+        double start = get_time_in_seconds();
+        #pragma omp parallel for schedule(static) num_threads(threads)
+        for (long i = 0; i < n; i++) {
+            c[i] = a[i];
+        }
+        double copy = get_time_in_seconds() - start;
+
+        start = get_time_in_seconds();
+        #pragma omp parallel for schedule(static) num_threads(threads)
+        for (long i = 0; i < n; i++) {
+            a[i] = b[i] + scalar * c[i];
+        }
+        double triad = get_time_in_seconds() - start;
+
+        // The first repetition only warms up, as in the reference STREAM
+        if (r == 0) {
+            continue;
+        }
+        if (best_copy < 0 || copy < best_copy) {
+            best_copy = copy;
+        }
+        if (best_triad < 0 || triad < best_triad) {
+            best_triad = triad;
+        }
+    }
+
+    free(a);
+    free(b);
+    free(c);
+
+    StreamResult* result = &results[num_results++];
+    result->threads = threads;
+    result->copy_gbps = 2.0 * sizeof(double) * n / best_copy / 1e9;
+    result->triad_gbps = 3.0 * sizeof(double) * n / best_triad / 1e9;
+    return result;
+}
@@ -0,0 +1,309 @@
+#include "../include/symmetry.h"
+#include "../include/config.h"
+#include "../include/mpi_parallel.h"
+#include "../include/mpi_phases.h"
+#include "../include/perf_counters.h"
+#include "../include/thread_stats.h"
+#include "../include/trace.h"
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* mode_names[NUM_SYMMETRY_MODES] = {"abs", "rel", "ulp"};
+
+const char* symmetry_mode_name(SymmetryMode mode) {
+    return mode >= 0 && mode < NUM_SYMMETRY_MODES ? mode_names[mode] : "unknown";
+}
+
+int symmetry_tolerance_parse(const char* arg, SymmetryTolerance* tolerance) {
+    const char* colon = strchr(arg, ':');
+    if (colon == NULL) {
+        return 0;
+    }
+    for (int m = 0; m < NUM_SYMMETRY_MODES; m++) {
+        if ((size_t)(colon - arg) == strlen(mode_names[m]) && strncmp(arg, mode_names[m], colon - arg) == 0) {
+            char* end;
+            double value = strtod(colon + 1, &end);
+            if (end == colon + 1 || *end != '\0' || !(value >= 0)) {
+                return 0;
+            }
+            tolerance->mode = m;
+            tolerance->tolerance = value;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Deviations are floats so that a row reduces at full SIMD width. Equal values (including
+// infinities and signed zeros) deviate by 0, NaNs and overflowing differences by infinity.
+static inline float abs_deviation(float a, float b) {
+    float d = fabsf(a - b);
+    return a == b ? 0.0f : (d <= FLT_MAX ? d : INFINITY);
+}
+
+static inline float rel_deviation(float a, float b) {
+    float d = fabsf(a - b);
+    return a == b ? 0.0f : (d <= FLT_MAX ? d / fmaxf(fabsf(a), fabsf(b)) : INFINITY);
+}
+
+// Float bits mapped to integers that are ordered like the floats, -0 and +0 both to 0
+static inline int32_t ordered_bits(float x) {
+    int32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits < 0 ? INT32_MIN - bits : bits;
+}
+
+// Exact up to 2^24 ULPs, well above any tolerance worth asking for. The distance is kept in
+// 32 bits so that the conversion vectorises without 64-bit integer support.
+static inline float ulp_deviation(float a, float b) {
+    if (a == b) {
+        return 0.0f;
+    }
+    if (a != a || b != b) {
+        return INFINITY;
+    }
+    int32_t x = ordered_bits(a);
+    int32_t y = ordered_bits(b);
+    uint32_t distance = x > y ? (uint32_t)x - (uint32_t)y : (uint32_t)y - (uint32_t)x;
+    return distance > INT32_MAX ? 2147483648.0f : (float)(int32_t)distance;
+}
+
+// Partial report of a thread or rank
+typedef struct {
+    float max;
+    int row;
+    int col;
+    long long violations;
+} Deviation;
+
+// Row ii of a tile: x[x_row + ii][x_col + jj] against y[y_row + jj][y_col + ii]. The location is
+// only searched for when the row beats the running maximum, which is rare after the first rows.
+#define SCAN_ROW(DEVIATION)                                                                     \
+    do {                                                                                        \
+        float row_max = 0.0f;                                                                   \
+        long long count = 0;                                                                    \
+        _Pragma("omp simd reduction(max:row_max) reduction(+:count)")                           \
+        for (int jj = first; jj < cols; jj++) {                                                 \
+            float d = DEVIATION(xr[jj], y[y_row + jj][y_col + ii]);                             \
+            row_max = d > row_max ? d : row_max;                                                \
+            count += d > limit;                                                                 \
+        }                                                                                       \
+        partial->violations += count;                                                           \
+        if (row_max > partial->max) {                                                           \
+            for (int jj = first; jj < cols; jj++) {                                             \
+                if (DEVIATION(xr[jj], y[y_row + jj][y_col + ii]) == row_max) {                  \
+                    partial->max = row_max;                                                     \
+                    partial->row = row0 + ii;                                                   \
+                    partial->col = col0 + jj;                                                   \
+                    break;                                                                      \
+                }                                                                               \
+            }                                                                                   \
+        }                                                                                       \
+    } while (0)
+
+// On a diagonal tile only the pairs above the diagonal are compared. row0 and col0 are the
+// global indices of the first row and column of the x side.
+static void scan_tile(float** x, int x_row, int x_col, float** y, int y_row, int y_col, int rows, int cols,
+                      int diagonal, int row0, int col0, SymmetryTolerance tolerance, Deviation* partial) {
+    float limit = (float)tolerance.tolerance;
+    for (int ii = 0; ii < rows; ii++) {
+        const float* xr = &x[x_row + ii][x_col];
+        int first = diagonal ? ii + 1 : 0;
+        switch (tolerance.mode) {
+            case SYMMETRY_ABS:
+                SCAN_ROW(abs_deviation);
+                break;
+            case SYMMETRY_REL:
+                SCAN_ROW(rel_deviation);
+                break;
+            default:
+                SCAN_ROW(ulp_deviation);
+                break;
+        }
+    }
+}
+
+#undef SCAN_ROW
+
+// Larger deviation first, then the first location in row-major order, so the report does
+// not depend on the thread or rank count
+static void merge_deviation(Deviation* into, const Deviation* other) {
+    into->violations += other->violations;
+    if (other->max > into->max ||
+        (other->max == into->max && other->row >= 0 &&
+         (into->row < 0 || other->row < into->row || (other->row == into->row && other->col < into->col)))) {
+        into->max = other->max;
+        into->row = other->row;
+        into->col = other->col;
+    }
+}
+
+static SymmetryReport to_report(const Deviation* deviation) {
+    SymmetryReport report = {deviation->max, deviation->row, deviation->col, deviation->violations};
+    return report;
+}
+
+static void print_report(const char* kernel, const SymmetryReport* report, SymmetryTolerance tolerance) {
+    if (report->row < 0) {
+        printf("%s: the matrix is exactly symmetric\n", kernel);
+        return;
+    }
+    printf("%s: max %s deviation %g at (%d, %d), %lld pairs above %g\n", kernel, symmetry_mode_name(tolerance.mode),
+           report->max_deviation, report->row, report->col, report->violations, tolerance.tolerance);
+}
+
+SymmetryReport check_symmetry_omp(float** matrix, int n, SymmetryTolerance tolerance, int block_size,
+                                  long double* time) {
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    Deviation total = {0.0f, -1, -1, 0};
+
+    #pragma omp parallel
+    {
+        double region_start = thread_stats_begin();
+        long items = 0;
+        Deviation partial = {0.0f, -1, -1, 0};
+
+        // Same tile grid as symmetrize_omp, every mirrored pair is visited from the upper tile
+        #pragma omp for collapse(2) schedule(dynamic) nowait
+        for (int i = 0; i < n; i += block_size) {
+            for (int j = 0; j < n; j += block_size) {
+                if (j < i) {
+                    continue;
+                }
+                TRACE_BEGIN("tile_pair");
+                scan_tile(matrix, i, j, matrix, j, i, i + block_size > n ? n - i : block_size,
+                          j + block_size > n ? n - j : block_size, i == j, i, j, tolerance, &partial);
+                TRACE_END("tile_pair");
+                items++;
+            }
+        }
+
+        thread_stats_busy(region_start, items);
+
+        #pragma omp critical
+        merge_deviation(&total, &partial);
+
+        #pragma omp barrier
+        thread_stats_end(region_start);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    SymmetryReport report = to_report(&total);
+    if (get_config()->VERBOSE_LEVEL > 1) {
+        print_report("check_symmetry_omp", &report, tolerance);
+    }
+    return report;
+}
+
+SymmetryReport check_symmetry_mpi(MPI_Comm comm, float** matrix, int n, int rank, int size,
+                                  SymmetryTolerance tolerance, long double* time, int verbosity) {
+    SymmetryReport report = {0.0, -1, -1, 0};
+
+    double start_time = mpi_phases_begin();
+    double mark = start_time;
+
+    if (n % size != 0) {
+        if (rank == 0) {
+            fprintf(stderr, "Matrix size n=%d is not divisible by number of processes size=%d.\n", n, size);
+        }
+        *time = mpi_phases_finish(start_time);
+        return report;
+    }
+    int rows = n / size;
+
+    float* flat_matrix = NULL;
+    if (rank == 0) {
+        flat_matrix = flatten_matrix(matrix, n);
+        if (flat_matrix == NULL) {
+            fprintf(stderr, "Failed to flatten the matrix.\n");
+            MPI_Abort(comm, EXIT_FAILURE);
+        }
+    }
+    mpi_phase_end(PHASE_FLATTEN, &mark);
+
+    // Local rows, then the r x r blocks of those rows by column block, then the mirrored blocks
+    size_t block = (size_t)rows * rows;
+    float* local = malloc((size_t)rows * n * sizeof(float));
+    float* send = malloc((size_t)rows * n * sizeof(float));
+    float* recv = malloc((size_t)rows * n * sizeof(float));
+    float** x = malloc(rows * sizeof(float*));
+    float** y = malloc(rows * sizeof(float*));
+    if (local == NULL || send == NULL || recv == NULL || x == NULL || y == NULL) {
+        fprintf(stderr, "Rank %d: Failed to allocate the buffers of check_symmetry_mpi.\n", rank);
+        MPI_Abort(comm, EXIT_FAILURE);
+    }
+
+    MPI_Datatype row = mpi_row_type(n);
+    MPI_Datatype piece = mpi_row_type(rows);
+
+    MPI_Scatter(flat_matrix, rows, row, local, rows, row, 0, comm);
+    mpi_phase_end(PHASE_DISTRIBUTE, &mark);
+
+    // Block q of the send buffer holds A[my rows][rows of q], which q compares against its own rows
+    for (int q = 0; q < size; q++) {
+        for (int ii = 0; ii < rows; ii++) {
+            memcpy(&send[q * block + (size_t)ii * rows], &local[(size_t)ii * n + (size_t)q * rows], rows * sizeof(float));
+        }
+    }
+    mpi_phase_end(PHASE_COMPUTE, &mark);
+
+    MPI_Alltoall(send, rows, piece, recv, rows, piece, comm);
+    mpi_phase_end(PHASE_EXCHANGE, &mark);
+
+    // Pairs of a block below the diagonal are compared by the rank that owns the mirrored rows
+    Deviation partial = {0.0f, -1, -1, 0};
+    for (int ii = 0; ii < rows; ii++) {
+        x[ii] = &local[(size_t)ii * n];
+    }
+    for (int q = rank; q < size; q++) {
+        for (int jj = 0; jj < rows; jj++) {
+            y[jj] = &recv[q * block + (size_t)jj * rows];
+        }
+        scan_tile(x, 0, q * rows, y, 0, 0, rows, rows, q == rank, rank * rows, q * rows, tolerance, &partial);
+    }
+    mpi_phase_end(PHASE_COMPUTE, &mark);
+
+    // The largest deviation wins, ties go to the lowest rank, which owns the first rows
+    struct {
+        double value;
+        int rank;
+    } local_max = {partial.max, rank}, global_max;
+    MPI_Allreduce(&local_max, &global_max, 1, MPI_DOUBLE_INT, MPI_MAXLOC, comm);
+    int location[2] = {partial.row, partial.col};
+    MPI_Bcast(location, 2, MPI_INT, global_max.rank, comm);
+    long long violations;
+    MPI_Allreduce(&partial.violations, &violations, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    mpi_phase_end(PHASE_GATHER, &mark);
+
+    report.max_deviation = global_max.value;
+    report.row = location[0];
+    report.col = location[1];
+    report.violations = violations;
+
+    MPI_Type_free(&row);
+    MPI_Type_free(&piece);
+    free(flat_matrix);
+    free(local);
+    free(send);
+    free(recv);
+    free(x);
+    free(y);
+
+    *time = mpi_phases_finish(start_time);
+
+    if (verbosity > 1 && rank == 0) {
+        print_report("check_symmetry_mpi", &report, tolerance);
+    }
+    return report;
+}
@@ -0,0 +1,68 @@
+#include "../include/thread_stats.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// One cache line per thread so that the updates of different threads never share a line
+typedef struct {
+    ThreadSample sample;
+    char padding[64 - sizeof(ThreadSample)];
+} ThreadSlot;
+
+static ThreadSlot* slots = NULL;
+static int num_slots = 0;
+static int armed = 0;
+
+void thread_stats_reset(int threads) {
+    if (threads > num_slots) {
+        free(slots);
+        if (posix_memalign((void**)&slots, 64, threads * sizeof(ThreadSlot)) != 0) {
+            fprintf(stderr, "Failed to allocate memory for thread statistics.\n");
+            exit(EXIT_FAILURE);
+        }
+        num_slots = threads;
+    }
+    memset(slots, 0, num_slots * sizeof(ThreadSlot));
+    armed = 1;
+}
+
+void thread_stats_collect(ThreadSample* samples, int threads) {
+    armed = 0;
+    for (int t = 0; t < threads && t < num_slots; t++) {
+        samples[t].busy += slots[t].sample.busy;
+        samples[t].idle += slots[t].sample.idle;
+        samples[t].items += slots[t].sample.items;
+    }
+}
+
+static ThreadSample* own_sample() {
+    int t = omp_get_thread_num();
+    return t < num_slots ? &slots[t].sample : NULL;
+}
+
+double thread_stats_begin() {
+    return armed ? omp_get_wtime() : 0;
+}
+
+void thread_stats_busy(double start, long items) {
+    if (!armed) {
+        return;
+    }
+    ThreadSample* sample = own_sample();
+    if (sample != NULL) {
+        sample->busy += omp_get_wtime() - start;
+        sample->items += items;
+    }
+}
+
+void thread_stats_end(double region_start) {
+    if (!armed) {
+        return;
+    }
+    ThreadSample* sample = own_sample();
+    if (sample != NULL) {
+        double idle = omp_get_wtime() - region_start - sample->busy;
+        sample->idle += idle > 0 ? idle : 0;
+    }
+}
@@ -0,0 +1,62 @@
+#include "../include/tiles.h"
+#include <stddef.h>
+
+// Each instance reads SIZE source rows per result row; with SIZE a constant the compiler
+// unrolls the inner loop and keeps the row pointers in registers. A new cache line of the
+// source rows starts every 16 result rows, only those column walks prefetch.
+#define DEFINE_FIXED_TILE(SIZE)                                                              \
+    static void transpose_tile_##SIZE(float** restrict matrix, float** restrict result,     \
+                                      int i, int j, int ahead) {                             \
+        for (int ii = 0; ii < SIZE; ii++) {                                                  \
+            float* restrict row = &result[i + ii][j];                                        \
+            if (ahead > 0 && ii % 16 == 0) {                                                 \
+                for (int jj = 0; jj < SIZE; jj++) {                                          \
+                    __builtin_prefetch(&matrix[j + jj + ahead][i + ii], 0, 1);               \
+                    row[jj] = matrix[j + jj][i + ii];                                        \
+                }                                                                            \
+            } else {                                                                         \
+                for (int jj = 0; jj < SIZE; jj++) {                                          \
+                    row[jj] = matrix[j + jj][i + ii];                                        \
+                }                                                                            \
+            }                                                                                \
+        }                                                                                    \
+    }
+
+DEFINE_FIXED_TILE(4)
+DEFINE_FIXED_TILE(8)
+DEFINE_FIXED_TILE(16)
+DEFINE_FIXED_TILE(32)
+DEFINE_FIXED_TILE(64)
+DEFINE_FIXED_TILE(128)
+DEFINE_FIXED_TILE(256)
+
+// Indexed by log2(size / MIN_FIXED_TILE)
+static const TileKernel fixed_tiles[] = {
+    transpose_tile_4,
+    transpose_tile_8,
+    transpose_tile_16,
+    transpose_tile_32,
+    transpose_tile_64,
+    transpose_tile_128,
+    transpose_tile_256,
+};
+
+TileKernel tile_kernel(int size) {
+    if (size < MIN_FIXED_TILE || size > MAX_FIXED_TILE || (size & (size - 1)) != 0) {
+        return NULL;
+    }
+
+    int index = 0;
+    while ((MIN_FIXED_TILE << index) < size) {
+        index++;
+    }
+    return fixed_tiles[index];
+}
+
+void transpose_tile(float** matrix, float** result, int i, int j, int rows, int cols) {
+    for (int ii = i; ii < i + rows; ii++) {
+        for (int jj = j; jj < j + cols; jj++) {
+            result[ii][jj] = matrix[jj][ii];
+        }
+    }
+}
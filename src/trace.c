@@ -0,0 +1,387 @@
+#include "../include/trace.h"
+
+#ifdef PARCO_TRACE
+
+#include <mpi.h>
+#include <omp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    const char* name;
+    double ts;      // microseconds since trace_init
+    double dur;     // microseconds, complete events only
+    char phase;     // 'B', 'E' or 'X'
+} TraceEvent;
+
+typedef struct TraceBuffer {
+    TraceEvent* events;
+    int count;
+    int capacity;
+    long dropped;
+    int tid;
+    struct TraceBuffer* next;
+} TraceBuffer;
+
+typedef struct TraceName {
+    char* name;
+    struct TraceName* next;
+} TraceName;
+
+static __thread TraceBuffer* own = NULL;
+static TraceBuffer* buffers = NULL;
+static int num_buffers = 0;
+static TraceName* names = NULL;
+static double epoch = 0;
+
+static double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void trace_init() {
+    // Every rank starts its clock right after the same barrier, so the timelines line up across nodes
+    PMPI_Barrier(MPI_COMM_WORLD);
+    epoch = now_us();
+}
+
+static TraceBuffer* own_buffer() {
+    if (own != NULL) {
+        return own;
+    }
+
+    TraceBuffer* buffer = calloc(1, sizeof(TraceBuffer));
+    if (buffer == NULL) {
+        fprintf(stderr, "Failed to allocate a trace buffer.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    #pragma omp critical(trace_buffers)
+    {
+        buffer->tid = num_buffers++;
+        buffer->next = buffers;
+        buffers = buffer;
+    }
+
+    own = buffer;
+    return own;
+}
+
+static void record(const char* name, char phase, double ts, double dur) {
+    TraceBuffer* buffer = own_buffer();
+
+    if (buffer->count == buffer->capacity) {
+        if (buffer->capacity == TRACE_MAX_EVENTS) {
+            buffer->dropped++;
+            return;
+        }
+        int capacity = buffer->capacity == 0 ? 4096 : buffer->capacity * 2;
+        capacity = capacity > TRACE_MAX_EVENTS ? TRACE_MAX_EVENTS : capacity;
+        TraceEvent* events = realloc(buffer->events, capacity * sizeof(TraceEvent));
+        if (events == NULL) {
+            buffer->dropped++;
+            return;
+        }
+        buffer->events = events;
+        buffer->capacity = capacity;
+    }
+
+    buffer->events[buffer->count++] = (TraceEvent){name, ts, dur, phase};
+}
+
+void trace_begin(const char* name) {
+    record(name, 'B', now_us() - epoch, 0);
+}
+
+void trace_end(const char* name) {
+    record(name, 'E', now_us() - epoch, 0);
+}
+
+void trace_span(const char* name, double seconds) {
+    double end = now_us() - epoch;
+    record(name, 'X', end - seconds * 1e6, seconds * 1e6);
+}
+
+const char* trace_intern(const char* name) {
+    const char* found = NULL;
+
+    #pragma omp critical(trace_names)
+    {
+        for (TraceName* entry = names; entry != NULL && found == NULL; entry = entry->next) {
+            if (strcmp(entry->name, name) == 0) {
+                found = entry->name;
+            }
+        }
+        if (found == NULL) {
+            TraceName* entry = malloc(sizeof(TraceName));
+            char* copy = strdup(name);
+            if (entry == NULL || copy == NULL) {
+                fprintf(stderr, "Failed to allocate a trace name.\n");
+                exit(EXIT_FAILURE);
+            }
+            entry->name = copy;
+            entry->next = names;
+            names = entry;
+            found = copy;
+        }
+    }
+
+    return found;
+}
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} TraceText;
+
+static void append(TraceText* text, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static void append(TraceText* text, const char* format, ...) {
+    va_list args;
+    for (;;) {
+        size_t room = text->capacity - text->length;
+        va_start(args, format);
+        int written = vsnprintf(text->data + text->length, room, format, args);
+        va_end(args);
+
+        if (written >= 0 && (size_t)written < room) {
+            text->length += written;
+            return;
+        }
+
+        size_t capacity = text->capacity == 0 ? 1 << 16 : text->capacity * 2;
+        char* data = realloc(text->data, capacity);
+        if (data == NULL) {
+            fprintf(stderr, "Failed to allocate memory for the trace.\n");
+            exit(EXIT_FAILURE);
+        }
+        text->data = data;
+        text->capacity = capacity;
+    }
+}
+
+void trace_write(const char* path) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    TraceText text = {NULL, 0, 0};
+    append(&text, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"rank %d\"}},\n", rank, rank);
+
+    long dropped = 0;
+    for (TraceBuffer* buffer = buffers; buffer != NULL; buffer = buffer->next) {
+        append(&text, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}},\n",
+               rank, buffer->tid, buffer->tid);
+
+        for (int i = 0; i < buffer->count; i++) {
+            const TraceEvent* event = &buffer->events[i];
+            if (event->phase == 'X') {
+                append(&text, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d},\n",
+                       event->name, event->ts, event->dur, rank, buffer->tid);
+            } else {
+                append(&text, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d},\n",
+                       event->name, event->phase, event->ts, rank, buffer->tid);
+            }
+        }
+        dropped += buffer->dropped;
+    }
+
+    if (dropped > 0) {
+        fprintf(stderr, "Warning: rank %d dropped %ld trace events (more than %d on a thread)\n", rank, dropped, TRACE_MAX_EVENTS);
+    }
+
+    // The text of every rank is concatenated on the root. The library calls go to PMPI_
+    // so that the merge itself does not show up in the trace.
+    int length = (int)text.length;
+    int* lengths = NULL;
+    int* displs = NULL;
+    char* merged = NULL;
+    if (rank == 0) {
+        lengths = malloc(size * sizeof(int));
+        displs = malloc(size * sizeof(int));
+        if (lengths == NULL || displs == NULL) {
+            fprintf(stderr, "Failed to allocate memory for the trace.\n");
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    PMPI_Gather(&length, 1, MPI_INT, lengths, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        long total = 0;
+        for (int r = 0; r < size; r++) {
+            displs[r] = (int)total;
+            total += lengths[r];
+        }
+        merged = malloc(total + 1);
+        if (merged == NULL || total > 0x7fffffff) {
+            fprintf(stderr, "The trace is too large to merge (%ld bytes)\n", total);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    PMPI_Gatherv(text.data, length, MPI_CHAR, merged, lengths, displs, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        size_t total = displs[size - 1] + lengths[size - 1];
+        // Drop the separator after the last event
+        if (total >= 2) {
+            total -= 2;
+        }
+
+        FILE* fp = fopen(path, "w");
+        if (fp == NULL) {
+            fprintf(stderr, "Failed to open trace file %s\n", path);
+        } else {
+            fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+            fwrite(merged, 1, total, fp);
+            fprintf(fp, "\n]}\n");
+            fclose(fp);
+            printf("Trace of %d ranks written to %s\n", size, path);
+        }
+    }
+
+    free(merged);
+    free(lengths);
+    free(displs);
+    free(text.data);
+}
+
+// Interposed MPI calls, forwarded to the profiling interface
+int MPI_Barrier(MPI_Comm comm) {
+    trace_begin("MPI_Barrier");
+    int result = PMPI_Barrier(comm);
+    trace_end("MPI_Barrier");
+    return result;
+}
+
+int MPI_Bcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm) {
+    trace_begin("MPI_Bcast");
+    int result = PMPI_Bcast(buffer, count, datatype, root, comm);
+    trace_end("MPI_Bcast");
+    return result;
+}
+
+int MPI_Scatter(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    trace_begin("MPI_Scatter");
+    int result = PMPI_Scatter(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    trace_end("MPI_Scatter");
+    return result;
+}
+
+int MPI_Scatterv(const void* sendbuf, const int sendcounts[], const int displs[], MPI_Datatype sendtype, void* recvbuf,
+                 int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    trace_begin("MPI_Scatterv");
+    int result = PMPI_Scatterv(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    trace_end("MPI_Scatterv");
+    return result;
+}
+
+int MPI_Iscatter(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                 MPI_Datatype recvtype, int root, MPI_Comm comm, MPI_Request* request) {
+    trace_begin("MPI_Iscatter");
+    int result = PMPI_Iscatter(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm, request);
+    trace_end("MPI_Iscatter");
+    return result;
+}
+
+int MPI_Gather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+               MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    trace_begin("MPI_Gather");
+    int result = PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    trace_end("MPI_Gather");
+    return result;
+}
+
+int MPI_Gatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[],
+                const int displs[], MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    trace_begin("MPI_Gatherv");
+    int result = PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+    trace_end("MPI_Gatherv");
+    return result;
+}
+
+int MPI_Igather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                MPI_Datatype recvtype, int root, MPI_Comm comm, MPI_Request* request) {
+    trace_begin("MPI_Igather");
+    int result = PMPI_Igather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm, request);
+    trace_end("MPI_Igather");
+    return result;
+}
+
+int MPI_Alltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                 MPI_Datatype recvtype, MPI_Comm comm) {
+    trace_begin("MPI_Alltoall");
+    int result = PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+    trace_end("MPI_Alltoall");
+    return result;
+}
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) {
+    trace_begin("MPI_Reduce");
+    int result = PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+    trace_end("MPI_Reduce");
+    return result;
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm) {
+    trace_begin("MPI_Allreduce");
+    int result = PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+    trace_end("MPI_Allreduce");
+    return result;
+}
+
+int MPI_Send(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm) {
+    trace_begin("MPI_Send");
+    int result = PMPI_Send(buf, count, datatype, dest, tag, comm);
+    trace_end("MPI_Send");
+    return result;
+}
+
+int MPI_Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status* status) {
+    trace_begin("MPI_Recv");
+    int result = PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+    trace_end("MPI_Recv");
+    return result;
+}
+
+int MPI_Isend(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm, MPI_Request* request) {
+    trace_begin("MPI_Isend");
+    int result = PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+    trace_end("MPI_Isend");
+    return result;
+}
+
+int MPI_Irecv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Request* request) {
+    trace_begin("MPI_Irecv");
+    int result = PMPI_Irecv(buf, count, datatype, source, tag, comm, request);
+    trace_end("MPI_Irecv");
+    return result;
+}
+
+int MPI_Startall(int count, MPI_Request array_of_requests[]) {
+    trace_begin("MPI_Startall");
+    int result = PMPI_Startall(count, array_of_requests);
+    trace_end("MPI_Startall");
+    return result;
+}
+
+int MPI_Wait(MPI_Request* request, MPI_Status* status) {
+    trace_begin("MPI_Wait");
+    int result = PMPI_Wait(request, status);
+    trace_end("MPI_Wait");
+    return result;
+}
+
+int MPI_Waitall(int count, MPI_Request array_of_requests[], MPI_Status* array_of_statuses) {
+    trace_begin("MPI_Waitall");
+    int result = PMPI_Waitall(count, array_of_requests, array_of_statuses);
+    trace_end("MPI_Waitall");
+    return result;
+}
+
+#endif // PARCO_TRACE
@@ -0,0 +1,170 @@
+#include "../include/tracked.h"
+#include "../include/config.h"
+#include "../include/perf_counters.h"
+#include "../include/thread_stats.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+TrackedMatrix* tracked_create(float** matrix, int n, int tile) {
+    if (n <= 0 || tile <= 0) {
+        fprintf(stderr, "Invalid tracked matrix arguments: n=%d tile=%d\n", n, tile);
+        return NULL;
+    }
+
+    TrackedMatrix* tracked = calloc(1, sizeof(TrackedMatrix));
+    if (tracked == NULL) {
+        return NULL;
+    }
+    tracked->matrix = matrix;
+    tracked->n = n;
+    tracked->tile = tile;
+    tracked->tiles = (n + tile - 1) / tile;
+
+    size_t cells = (size_t)tracked->tiles * tracked->tiles;
+    tracked->dirty_words = (cells + 63) / 64;
+    tracked->dirty = calloc(tracked->dirty_words, sizeof(uint64_t));
+    tracked->pair_state = calloc(cells, sizeof(uint8_t));
+    if (tracked->dirty == NULL || tracked->pair_state == NULL) {
+        tracked_destroy(tracked);
+        return NULL;
+    }
+    tracked_mark_dirty(tracked, 0, 0, n, n);
+    return tracked;
+}
+
+void tracked_destroy(TrackedMatrix* tracked) {
+    if (tracked == NULL) {
+        return;
+    }
+    free(tracked->dirty);
+    free(tracked->pair_state);
+    free(tracked);
+}
+
+static inline void mark_tile(TrackedMatrix* tracked, size_t cell) {
+    uint64_t bit = (uint64_t)1 << (cell % 64);
+    #pragma omp atomic
+    tracked->dirty[cell / 64] |= bit;
+}
+
+// Bits of word w that stand for a tile; the tail of the last word stands for none
+static inline uint64_t tile_bits(const TrackedMatrix* tracked, size_t w) {
+    size_t cells = (size_t)tracked->tiles * tracked->tiles;
+    if (w == tracked->dirty_words - 1 && cells % 64 != 0) {
+        return ((uint64_t)1 << (cells % 64)) - 1;
+    }
+    return ~(uint64_t)0;
+}
+
+static inline int is_dirty(const TrackedMatrix* tracked, size_t cell) {
+    return tracked->dirty[cell / 64] >> (cell % 64) & 1;
+}
+
+void tracked_set(TrackedMatrix* tracked, int i, int j, float value) {
+    tracked->matrix[i][j] = value;
+    mark_tile(tracked, (size_t)(i / tracked->tile) * tracked->tiles + j / tracked->tile);
+}
+
+void tracked_mark_dirty(TrackedMatrix* tracked, int row, int col, int rows, int cols) {
+    // Clipped to the matrix, so no bit past the last tile is ever set
+    int max_row = row + rows > tracked->n ? tracked->n : row + rows;
+    int max_col = col + cols > tracked->n ? tracked->n : col + cols;
+    row = row < 0 ? 0 : row;
+    col = col < 0 ? 0 : col;
+    if (max_row <= row || max_col <= col) {
+        return;
+    }
+    int last_row = (max_row - 1) / tracked->tile;
+    int last_col = (max_col - 1) / tracked->tile;
+    for (int ti = row / tracked->tile; ti <= last_row; ti++) {
+        for (int tj = col / tracked->tile; tj <= last_col; tj++) {
+            mark_tile(tracked, (size_t)ti * tracked->tiles + tj);
+        }
+    }
+}
+
+// Tile pair (ti, tj), ti <= tj, against its mirror; on the diagonal only the upper half
+static bool tile_pair_symmetric(float** matrix, int n, int tile, int ti, int tj) {
+    int i0 = ti * tile, j0 = tj * tile;
+    int max_i = i0 + tile > n ? n : i0 + tile;
+    int max_j = j0 + tile > n ? n : j0 + tile;
+    for (int i = i0; i < max_i; i++) {
+        for (int j = ti == tj ? i + 1 : j0; j < max_j; j++) {
+            if (matrix[i][j] != matrix[j][i]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool tracked_is_symmetric(TrackedMatrix* tracked, long double* time) {
+    struct timespec start, end;
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int tiles = tracked->tiles;
+    long long delta = 0, checked = 0;
+
+    #pragma omp parallel reduction(+:delta, checked)
+    {
+        double region_start = thread_stats_begin();
+        long items = 0;
+
+        // Clean words are skipped whole, so a re-check after a few row updates reads almost
+        // nothing but the bitmap
+        #pragma omp for schedule(dynamic, 16) nowait
+        for (size_t w = 0; w < tracked->dirty_words; w++) {
+            uint64_t bits = tracked->dirty[w] & tile_bits(tracked, w);
+            while (bits != 0) {
+                size_t cell = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+
+                // The pair is checked from its upper tile, or from the lower one when that is
+                // the only dirty side
+                int ti = cell / tiles, tj = cell % tiles;
+                if (ti > tj) {
+                    if (is_dirty(tracked, (size_t)tj * tiles + ti)) {
+                        continue;
+                    }
+                    int swap = ti;
+                    ti = tj;
+                    tj = swap;
+                }
+
+                TRACE_BEGIN("tile_pair");
+                uint8_t* state = &tracked->pair_state[(size_t)ti * tiles + tj];
+                uint8_t next = tile_pair_symmetric(tracked->matrix, tracked->n, tracked->tile, ti, tj)
+                                   ? TILE_PAIR_SYMMETRIC : TILE_PAIR_ASYMMETRIC;
+                delta += (next == TILE_PAIR_ASYMMETRIC) - (*state == TILE_PAIR_ASYMMETRIC);
+                *state = next;
+                TRACE_END("tile_pair");
+                checked++;
+                items++;
+            }
+        }
+
+        thread_stats_busy(region_start, items);
+        #pragma omp barrier
+        thread_stats_end(region_start);
+    }
+
+    // Cleared only once every thread is done reading the mirrored bits
+    memset(tracked->dirty, 0, tracked->dirty_words * sizeof(uint64_t));
+    tracked->asymmetric_pairs += delta;
+    tracked->checked_pairs = checked;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    bool symmetric = tracked->asymmetric_pairs == 0;
+    if (get_config()->VERBOSE_LEVEL > 1) {
+        printf("Re-checked %lld of %lld tile pairs, the matrix is %ssymmetric, in: %Lf\n", checked,
+               (long long)tiles * (tiles + 1) / 2, symmetric ? "" : "not ", *time);
+    }
+    return symmetric;
+}
@@ -2,6 +2,7 @@
 #include <time.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <mpi.h>
 #include "../include/utils.h"
 #include "../include/sequential.h"
@@ -9,6 +10,24 @@
 #include "../include/config.h"
 #include "../include/implicit_parallel.h"
 #include "../include/mpi_parallel.h"
+#include "../include/mpi_plan.h"
+#include "../include/omp_plan.h"
+#include "../include/autotune.h"
+#include "../include/perf_counters.h"
+#include "../include/stream.h"
+#include "../include/mpi_phases.h"
+#include "../include/thread_stats.h"
+#include "../include/trace.h"
+#include "../include/results.h"
+#include "../include/affinity.h"
+#include "../include/work_stealing.h"
+#include "../include/inplace.h"
+#include "../include/fused.h"
+#include "../include/symmetry.h"
+#include "../include/tracked.h"
+#include "../include/sparse.h"
+#include "../include/packed.h"
+#include "../include/matrix_io.h"
 
 void print_matrix(float** matrix, int n) {
     for (int i = 0; i < n; i++) {
@@ -89,42 +108,457 @@ void deallocate_matrix(float** matrix, int n) {
     free(matrix);
 }
 
-void benchmark_function(void (*func)(long double*), const char* func_name) {
+float** allocate_matrix(int n) {
+    float** matrix = malloc(n * sizeof(float*));
+    if (matrix == NULL) {
+        fprintf(stderr, "Failed to allocate memory for matrix pointers.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        matrix[i] = malloc(n * sizeof(float));
+        if (matrix[i] == NULL) {
+            fprintf(stderr, "Failed to allocate memory for matrix row %d.\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return matrix;
+}
+
+// Cache line aligned buffer, released with free()
+void* allocate_aligned(size_t bytes) {
+    void* buffer = NULL;
+    if (posix_memalign(&buffer, 64, bytes == 0 ? 64 : bytes) != 0) {
+        return NULL;
+    }
+    return buffer;
+}
+
+size_t matrix_peak_bytes(int n, int ranks, int rank, int mpi_kernels, int flat_root, int replicated) {
+    size_t matrix = (size_t)n * n * sizeof(float);
+    size_t block = matrix / ranks;
+
+    if (rank >= ranks) {
+        return 0;
+    }
+    if (rank == 0) {
+        // MATRIX, RESULT and the kernel output, plus a flat copy in and out or the streaming staging buffer
+        size_t staging = (size_t)get_config()->MPI_STAGING_MB << 20;
+        return 3 * matrix + (flat_root ? 2 * matrix + 2 * block : 0) + (mpi_kernels ? staging : 0);
+    }
+    if (!mpi_kernels) {
+        return 0;
+    }
+    // Flat copy, flat transpose and rebuilt matrix on every rank when the whole matrix is broadcast
+    return replicated ? 3 * matrix + 2 * block : 2 * block;
+}
+
+// Memory this process could still get: MemAvailable, lowered to the cgroup limit of the job
+static size_t available_memory() {
+    size_t available = 0;
+    FILE* fp = fopen("/proc/meminfo", "r");
+    if (fp != NULL) {
+        char line[256];
+        unsigned long long kb;
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            if (sscanf(line, "MemAvailable: %llu kB", &kb) == 1) {
+                available = (size_t)kb * 1024;
+                break;
+            }
+        }
+        fclose(fp);
+    }
+
+    unsigned long long limit, current;
+    FILE* max_fp = fopen("/sys/fs/cgroup/memory.max", "r");
+    FILE* cur_fp = fopen("/sys/fs/cgroup/memory.current", "r");
+    if (max_fp != NULL && cur_fp != NULL && fscanf(max_fp, "%llu", &limit) == 1 && fscanf(cur_fp, "%llu", &current) == 1) {
+        size_t headroom = limit > current ? (size_t)(limit - current) : 0;
+        if (available == 0 || headroom < available) {
+            available = headroom;
+        }
+    }
+    if (max_fp != NULL) {
+        fclose(max_fp);
+    }
+    if (cur_fp != NULL) {
+        fclose(cur_fp);
+    }
+    return available;
+}
+
+int memory_fits(size_t bytes, int n) {
+    static MPI_Comm node_comm = MPI_COMM_NULL;
+    if (node_comm == MPI_COMM_NULL) {
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+    }
+
+    // Ranks sharing a node share its memory
+    unsigned long long mine = bytes, node = 0;
+    MPI_Allreduce(&mine, &node, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, node_comm);
+
+    int node_rank;
+    MPI_Comm_rank(node_comm, &node_rank);
+    size_t available = available_memory();
+    int fits = available == 0 || node <= available;
+    if (!fits && node_rank == 0) {
+        fprintf(stderr, "Skipping size %d: it needs %.2f GiB on this node, %.2f GiB are available\n",
+                n, node / 1073741824.0, available / 1073741824.0);
+    }
+
+    int all;
+    MPI_Allreduce(&fits, &all, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return all;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// Linear interpolation between closest ranks, same as numpy's default
+static double percentile(const double* sorted, int count, double p) {
+    double position = p * (count - 1);
+    int lower = (int)position;
+    int upper = lower + 1 < count ? lower + 1 : lower;
+    return sorted[lower] + (position - lower) * (sorted[upper] - sorted[lower]);
+}
+
+// Two-sided 95% Student t quantiles for 1 to 30 degrees of freedom
+static double student_t95(int dof) {
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (dof <= 0) {
+        return 0;
+    }
+    return dof <= 30 ? table[dof - 1] : 1.960;
+}
+
+void compute_sample_stats(const double* samples, int count, SampleStats* stats) {
+    double* sorted = malloc(count * sizeof(double));
+    if (sorted == NULL) {
+        fprintf(stderr, "Failed to allocate memory for sample statistics.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(sorted, samples, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compare_doubles);
+
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += sorted[i];
+    }
+    stats->mean = sum / count;
+
+    double squares = 0;
+    for (int i = 0; i < count; i++) {
+        squares += (sorted[i] - stats->mean) * (sorted[i] - stats->mean);
+    }
+    stats->stddev = count > 1 ? sqrt(squares / (count - 1)) : 0;
+    stats->ci95 = count > 1 ? student_t95(count - 1) * stats->stddev / sqrt(count) : 0;
+
+    stats->min = sorted[0];
+    stats->median = percentile(sorted, count, 0.5);
+    stats->p90 = percentile(sorted, count, 0.9);
+    stats->p99 = percentile(sorted, count, 0.99);
+
+    free(sorted);
+}
+
+// Writing 5 to clear_refs resets VmHWM to the current RSS, so the next peak is the entry's own
+static void reset_peak_rss() {
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if (fp != NULL) {
+        fputs("5", fp);
+        fclose(fp);
+    }
+}
+
+// Peak resident set size since the last reset in MiB, -1 when unknown
+static double read_peak_rss_mb() {
+    double peak = -1;
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (fp != NULL) {
+        char line[256];
+        long kb;
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            if (sscanf(line, "VmHWM: %ld kB", &kb) == 1) {
+                peak = kb / 1024.0;
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    return peak;
+}
+
+// Collective entries are run by every rank of CURR_COMM, so their counters can be reduced over the ranks
+static void run_benchmark(void (*func)(long double*), const char* func_name, double bytes_moved, int collective) {
     Config* cfg = get_config();
 
     int rank, size;
     MPI_Comm_rank(cfg->CURR_COMM, &rank);
     MPI_Comm_size(cfg->CURR_COMM, &size);
 
-    double total_time = 0.0;
+    // Warm-up runs fault in pages, wake the thread pool and fill the caches, and are discarded
+    for (int i = 0; i < cfg->WARMUP_RUNS; i++) {
+        long double time;
+        func(&time);
+    }
+
+    // time is what the kernel reports, call_time is the whole call including its setup and teardown
+    double* samples = malloc(cfg->NUM_RUNS * sizeof(double));
+    double* call_samples = malloc(cfg->NUM_RUNS * sizeof(double));
+    if (samples == NULL || call_samples == NULL) {
+        fprintf(stderr, "Failed to allocate memory for benchmark samples.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // MPI kernels run on the main thread of every rank, the others on the OpenMP team of rank 0.
+    // The kernels enable the counters over their timed region only, not the allocations around it.
+    PerfCounts counts;
+    perf_counts_clear(&counts);
+    int counting = cfg->PERF_COUNTERS && perf_counters_open(collective ? 1 : cfg->OMP_THREADS) > 0;
+
+    // Per-phase seconds of the MPI kernels, summed over the runs on this rank
+    double phases[NUM_MPI_PHASES] = {0};
+
+    // Per-thread work of the OpenMP kernels, summed over the runs
+    ThreadSample* threads = NULL;
+    if (cfg->THREAD_STATS && !collective) {
+        threads = calloc(cfg->OMP_THREADS, sizeof(ThreadSample));
+        if (threads == NULL) {
+            fprintf(stderr, "Failed to allocate memory for thread statistics.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    reset_peak_rss();
+
     for (int i = 0; i < cfg->NUM_RUNS; i++) {
         if (rank == 0) {
             print_loading_bar(i, cfg->NUM_RUNS);
         }
         long double time;
+        if (counting) {
+            perf_counters_arm();
+        }
+        if (threads != NULL) {
+            thread_stats_reset(cfg->OMP_THREADS);
+        }
+        TRACE_BEGIN_DYNAMIC(func_name);
+        double call_start = get_time_in_seconds();
         func(&time);
-        total_time += time;
+        call_samples[i] = get_time_in_seconds() - call_start;
+        TRACE_END_DYNAMIC(func_name);
+        if (threads != NULL) {
+            thread_stats_collect(threads, cfg->OMP_THREADS);
+        }
+        if (counting) {
+            perf_counters_disarm(&counts);
+        }
+        samples[i] = time;
+
+        if (collective) {
+            const MPIPhaseTimes* last = mpi_phases_last();
+            for (int p = 0; p < NUM_MPI_PHASES; p++) {
+                phases[p] += last->seconds[p];
+            }
+        }
+    }
+
+    // Peak RSS of every rank that ran the entry, measured over the timed runs
+    double peak_rss = read_peak_rss_mb();
+    double* rank_rss = NULL;
+    if (rank == 0) {
+        rank_rss = malloc((collective ? size : 1) * sizeof(double));
+        if (rank_rss == NULL) {
+            fprintf(stderr, "Failed to allocate memory for the peak RSS of the ranks.\n");
+            exit(EXIT_FAILURE);
+        }
+        rank_rss[0] = peak_rss;
+    }
+    if (collective) {
+        MPI_Gather(&peak_rss, 1, MPI_DOUBLE, rank_rss, 1, MPI_DOUBLE, 0, cfg->CURR_COMM);
+    }
+
+    if (counting) {
+        perf_counters_close();
+    } else {
+        for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+            counts.available[e] = 0;
+        }
+    }
+
+    if (collective && cfg->PERF_COUNTERS) {
+        PerfCounts total;
+        MPI_Reduce(counts.values, total.values, PERF_NUM_EVENTS, MPI_LONG_LONG, MPI_SUM, 0, cfg->CURR_COMM);
+        MPI_Reduce(counts.available, total.available, PERF_NUM_EVENTS, MPI_INT, MPI_MIN, 0, cfg->CURR_COMM);
+        counts = total;
+    }
+
+    // Slowest, fastest and average rank for each phase, per run
+    double phase_max[NUM_MPI_PHASES], phase_min[NUM_MPI_PHASES], phase_sum[NUM_MPI_PHASES];
+    if (collective) {
+        for (int p = 0; p < NUM_MPI_PHASES; p++) {
+            phases[p] /= cfg->NUM_RUNS;
+        }
+        MPI_Reduce(phases, phase_max, NUM_MPI_PHASES, MPI_DOUBLE, MPI_MAX, 0, cfg->CURR_COMM);
+        MPI_Reduce(phases, phase_min, NUM_MPI_PHASES, MPI_DOUBLE, MPI_MIN, 0, cfg->CURR_COMM);
+        MPI_Reduce(phases, phase_sum, NUM_MPI_PHASES, MPI_DOUBLE, MPI_SUM, 0, cfg->CURR_COMM);
     }
 
     if (rank == 0) {
         printf("\x1b[2K");
 
+        SampleStats stats, call_stats;
+        compute_sample_stats(samples, cfg->NUM_RUNS, &stats);
+        compute_sample_stats(call_samples, cfg->NUM_RUNS, &call_stats);
+
         if (cfg->VERBOSE_LEVEL > 0) {
-            printf("%s average time: %f seconds\n", func_name, total_time / cfg->NUM_RUNS);
+            printf("%s average time: %.9e seconds (median %.9e, 95%% CI +/- %.3e, per call: %.9e seconds)\n",
+                   func_name, stats.mean, stats.median, stats.ci95, call_stats.mean);
+        }
+
+        double busy_max = 0, busy_sum = 0, idle_sum = 0;
+        for (int t = 0; threads != NULL && t < cfg->OMP_THREADS; t++) {
+            busy_max = threads[t].busy > busy_max ? threads[t].busy : busy_max;
+            busy_sum += threads[t].busy;
+            idle_sum += threads[t].idle;
         }
 
-        FILE *fp = fopen("benchmark_results.csv", "a");
+        // The row is built in memory and then appended to every results file
+        char* row = NULL;
+        size_t row_length = 0;
+        FILE *fp = open_memstream(&row, &row_length);
         if (fp != NULL) {
-            total_time /= cfg->NUM_RUNS;
+            fprintf(fp, "%d,%d,%d,%.9e,%s,%.9e,%.9e,%.9e,%.9e,%.9e,%.9e,%.9e",
+                    cfg->MATRIX_DIMENSION, cfg->OMP_THREADS, cfg->BLOCK_SIZE, stats.mean, func_name, call_stats.mean,
+                    stats.min, stats.median, stats.p90, stats.p99, stats.stddev, stats.ci95);
+
+            // Counters are per run, summed over threads or ranks, and left empty when unavailable
+            for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+                if (counts.available[e]) {
+                    fprintf(fp, ",%lld", counts.values[e] / cfg->NUM_RUNS);
+                } else {
+                    fprintf(fp, ",");
+                }
+            }
 
-            if (total_time == 0) {
-                total_time = 0.000001;
+            // Achieved bandwidth from the mean time, against the STREAM copy peak at this thread count
+            const StreamResult* peak = stream_result(cfg->OMP_THREADS);
+            if (bytes_moved > 0 && stats.mean > 0) {
+                double gbps = bytes_moved / stats.mean / 1e9;
+                if (peak != NULL) {
+                    fprintf(fp, ",%.6f,%.4f", gbps, 100.0 * gbps / peak->copy_gbps);
+                } else {
+                    fprintf(fp, ",%.6f,", gbps);
+                }
+            } else {
+                fprintf(fp, ",,");
+            }
+
+            for (int p = 0; p < NUM_MPI_PHASES; p++) {
+                if (collective) {
+                    fprintf(fp, ",%.9e,%.9e,%.9e", phase_max[p], phase_min[p], phase_sum[p] / size);
+                } else {
+                    fprintf(fp, ",,,");
+                }
             }
 
-            fprintf(fp, "%d,%d,%d,%f,%s\n", cfg->MATRIX_DIMENSION, cfg->OMP_THREADS, cfg->BLOCK_SIZE, total_time, func_name);
+            // Imbalance is the busiest thread over the mean, empty for kernels without instrumentation
+            if (busy_sum > 0) {
+                fprintf(fp, ",%.4f,%.2f", busy_max / (busy_sum / cfg->OMP_THREADS), 100.0 * idle_sum / (busy_sum + idle_sum));
+            } else {
+                fprintf(fp, ",,");
+            }
+
+            // MPI entries run one thread per rank, the others on the team of rank 0
+            fprintf(fp, ",%s,%s", bind_policy_name(cfg->BIND_POLICY),
+                    collective ? affinity_rank_placement(size) : affinity_team_placement());
+
+            // Largest peak over the ranks, then the peak of every rank separated by ';'
+            int ranks = collective ? size : 1;
+            double rss_max = -1;
+            for (int r = 0; r < ranks; r++) {
+                rss_max = rank_rss[r] > rss_max ? rank_rss[r] : rss_max;
+            }
+            if (rss_max >= 0) {
+                fprintf(fp, ",%.1f,", rss_max);
+                for (int r = 0; r < ranks; r++) {
+                    fprintf(fp, "%s%.1f", r > 0 ? ";" : "", rank_rss[r]);
+                }
+            } else {
+                fprintf(fp, ",,");
+            }
+
+            // Empty for kernels without software prefetch, and the density for dense kernels
+            if (cfg->PREFETCH_DISTANCE >= 0) {
+                fprintf(fp, ",%d", cfg->PREFETCH_DISTANCE);
+            } else {
+                fprintf(fp, ",");
+            }
+            if (cfg->SPARSE_DENSITY > 0) {
+                fprintf(fp, ",%g", cfg->SPARSE_DENSITY);
+            } else {
+                fprintf(fp, ",");
+            }
+
+            fprintf(fp, "\n");
             fclose(fp);
+
+            append_result_row(row);
+            free(row);
+        }
+
+        fp = fopen("benchmark_samples.csv", "a");
+        if (fp != NULL) {
+            for (int i = 0; i < cfg->NUM_RUNS; i++) {
+                fprintf(fp, "%d,%d,%d,%s,%d,%.9e,%.9e\n", cfg->MATRIX_DIMENSION, cfg->OMP_THREADS, cfg->BLOCK_SIZE,
+                        func_name, i, samples[i], call_samples[i]);
+            }
+            fclose(fp);
+        }
+
+        if (cfg->THREAD_STATS > 1 && busy_sum > 0) {
+            fp = fopen("benchmark_threads.csv", "a");
+            if (fp != NULL) {
+                for (int t = 0; t < cfg->OMP_THREADS; t++) {
+                    fprintf(fp, "%d,%d,%d,%s,%d,%.9e,%.9e,%ld\n", cfg->MATRIX_DIMENSION, cfg->OMP_THREADS, cfg->BLOCK_SIZE,
+                            func_name, t, threads[t].busy / cfg->NUM_RUNS, threads[t].idle / cfg->NUM_RUNS,
+                            threads[t].items / cfg->NUM_RUNS);
+                }
+                fclose(fp);
+            }
         }
     }
+
+    free(rank_rss);
+    free(threads);
+    free(samples);
+    free(call_samples);
+}
+
+void benchmark_function(void (*func)(long double*), const char* func_name, double bytes_moved) {
+    run_benchmark(func, func_name, bytes_moved, 0);
+}
+
+void benchmark_mpi_function(void (*func)(long double*), const char* func_name, double bytes_moved) {
+    run_benchmark(func, func_name, bytes_moved, 1);
+}
+
+// Loads --input again from the page cache, so the time is the parsing and conversion that
+// every job pays before its first kernel
+void load_input_wrapper(long double* time) {
+    Config* cfg = get_config();
+    InputMatrix input;
+    if (input_load(cfg->INPUT_PATH, &input) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    *time = input.seconds;
+    input_release(&input);
 }
 
 void is_symmetric_sequential_wrapper(long double* time) {
@@ -196,6 +630,157 @@ void transpose_cache_oblivious_wrapper(long double* time) {
     deallocate_matrix(result, cfg->MATRIX_DIMENSION);
 }
 
+void transpose_cache_oblivious_ws_wrapper(long double* time) {
+    Config* cfg = get_config();
+    float** result = transpose_cache_oblivious_ws(cfg->MATRIX, cfg->MATRIX_DIMENSION, time);
+    deallocate_matrix(result, cfg->MATRIX_DIMENSION);
+}
+
+void omp_plan_wrapper(long double* time) {
+    Config* cfg = get_config();
+
+    // The plan and the output matrix are prepared by kernel setup, so every call only transposes
+    omp_plan_execute(cfg->OMP_PLAN, cfg->MATRIX, cfg->RESULT, time);
+}
+
+// Each run transposes the buffer left by the previous one back, so every run follows the same cycles
+void transpose_inplace_wrapper(long double* time) {
+    Config* cfg = get_config();
+    int rows = cfg->MATRIX_DIMENSION / 2;
+    int cols = 2 * cfg->MATRIX_DIMENSION;
+
+    if (cfg->INPLACE_TRANSPOSED) {
+        transpose_inplace(cfg->INPLACE_DATA, cols, rows, cfg->OMP_THREADS, time);
+    } else {
+        transpose_inplace(cfg->INPLACE_DATA, rows, cols, cfg->OMP_THREADS, time);
+    }
+    cfg->INPLACE_TRANSPOSED ^= 1;
+}
+
+void inplace_plan_wrapper(long double* time) {
+    Config* cfg = get_config();
+    inplace_plan_execute(cfg->INPLACE_PLAN, cfg->INPLACE_DATA, cfg->INPLACE_TRANSPOSED, time);
+    cfg->INPLACE_TRANSPOSED ^= 1;
+}
+
+// Works on RESULT, which kernel setup fills with a copy of MATRIX. Once symmetric the matrix stays
+// so, but every run still reads and writes every mirrored pair, so the runs cost the same.
+void symmetrize_omp_wrapper(long double* time) {
+    Config* cfg = get_config();
+    symmetrize_omp(cfg->RESULT, cfg->MATRIX_DIMENSION, cfg->BLOCK_SIZE, cfg->SYMMETRIZE_MODE, time);
+}
+
+// Scalars of the fused entries. RESULT accumulates over the runs, a beta below 1 keeps it bounded.
+#define FUSED_ALPHA 2.0f
+#define FUSED_BETA 0.5f
+
+void somatcopy_omp_wrapper(long double* time) {
+    Config* cfg = get_config();
+    somatcopy_omp('T', cfg->MATRIX_DIMENSION, FUSED_ALPHA, cfg->MATRIX, cfg->RESULT, cfg->BLOCK_SIZE, time);
+}
+
+void somatadd_omp_wrapper(long double* time) {
+    Config* cfg = get_config();
+    somatadd_omp('T', 'N', cfg->MATRIX_DIMENSION, FUSED_ALPHA, cfg->MATRIX, FUSED_BETA, cfg->RESULT, cfg->RESULT,
+                 cfg->BLOCK_SIZE, time);
+}
+
+void somatadd_unfused_omp_wrapper(long double* time) {
+    Config* cfg = get_config();
+    somatadd_unfused_omp(cfg->MATRIX_DIMENSION, FUSED_ALPHA, cfg->MATRIX, FUSED_BETA, cfg->RESULT, cfg->BLOCK_SIZE, time);
+}
+
+void dense_to_packed_omp_wrapper(long double* time) {
+    Config* cfg = get_config();
+    dense_to_packed_omp(cfg->MATRIX, cfg->PACKED, cfg->BLOCK_SIZE, time);
+}
+
+void packed_to_dense_omp_wrapper(long double* time) {
+    Config* cfg = get_config();
+    packed_to_dense_omp(cfg->PACKED, cfg->RESULT, cfg->BLOCK_SIZE, time);
+}
+
+// Both work on the random symmetric CSR matrix that kernel setup builds for the current density
+void csr_transpose_omp_wrapper(long double* time) {
+    Config* cfg = get_config();
+    CSRMatrix* result = csr_transpose_omp(cfg->SPARSE, time);
+    if (result == NULL) {
+        fprintf(stderr, "Failed to allocate the transposed sparse matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    csr_destroy(result);
+}
+
+void csr_is_symmetric_omp_wrapper(long double* time) {
+    Config* cfg = get_config();
+    csr_is_symmetric_omp(cfg->SPARSE, time);
+}
+
+// RESULT holds the dense form of the sparse matrix, see kernel setup
+void csr_from_dense_omp_wrapper(long double* time) {
+    Config* cfg = get_config();
+    CSRMatrix* result = csr_from_dense_omp(cfg->RESULT, cfg->MATRIX_DIMENSION, cfg->MATRIX_DIMENSION, time);
+    if (result == NULL) {
+        fprintf(stderr, "Failed to allocate the compressed sparse matrix.\n");
+        exit(EXIT_FAILURE);
+    }
+    csr_destroy(result);
+}
+
+void transpose_auto_wrapper(long double* time) {
+    Config* cfg = get_config();
+    float** result = transpose_auto(cfg->MATRIX, cfg->MATRIX_DIMENSION, time);
+    deallocate_matrix(result, cfg->MATRIX_DIMENSION);
+}
+
+void check_symmetry_omp_wrapper(long double* time) {
+    Config* cfg = get_config();
+    SymmetryTolerance tolerance = {cfg->SYMMETRY_MODE, cfg->SYMMETRY_TOLERANCE};
+    check_symmetry_omp(cfg->MATRIX, cfg->MATRIX_DIMENSION, tolerance, cfg->BLOCK_SIZE, time);
+}
+
+// Rows rewritten between two re-checks of is_symmetric_tracked
+#define TRACKED_UPDATE_ROWS 4
+
+// Every run rewrites a few rows and the mirrored columns, keeping the matrix symmetric, then
+// re-checks. The rows go through tracked_set and the columns are written directly and marked
+// as a range, and only the re-check is timed.
+void is_symmetric_tracked_wrapper(long double* time) {
+    Config* cfg = get_config();
+    static unsigned int update = 0;
+    int n = cfg->MATRIX_DIMENSION;
+    float** matrix = cfg->TRACKED->matrix;
+
+    for (int k = 0; k < TRACKED_UPDATE_ROWS; k++) {
+        int r = (int)(((unsigned long long)update++ * 2654435761u) % n);
+        for (int j = 0; j < n; j++) {
+            float value = matrix[r][j] + 1.0f;
+            tracked_set(cfg->TRACKED, r, j, value);
+            matrix[j][r] = value;
+        }
+        tracked_mark_dirty(cfg->TRACKED, 0, r, n, 1);
+    }
+
+    tracked_is_symmetric(cfg->TRACKED, time);
+}
+
+// Reference for is_symmetric_tracked: the whole matrix is marked dirty, as a full rescan
+void is_symmetric_tracked_full_wrapper(long double* time) {
+    Config* cfg = get_config();
+    tracked_mark_dirty(cfg->TRACKED, 0, 0, cfg->MATRIX_DIMENSION, cfg->MATRIX_DIMENSION);
+    tracked_is_symmetric(cfg->TRACKED, time);
+}
+
+void check_symmetry_mpi_wrapper(long double* time) {
+    Config* cfg = get_config();
+    int rank, size;
+    MPI_Comm_rank(cfg->CURR_COMM, &rank);
+    MPI_Comm_size(cfg->CURR_COMM, &size);
+    SymmetryTolerance tolerance = {cfg->SYMMETRY_MODE, cfg->SYMMETRY_TOLERANCE};
+    check_symmetry_mpi(cfg->CURR_COMM, cfg->MATRIX, cfg->MATRIX_DIMENSION, rank, size, tolerance, time,
+                       cfg->VERBOSE_LEVEL);
+}
+
 void is_symmetric_mpi_wrapper(long double* time) {
     Config* cfg = get_config();
 
@@ -206,6 +791,18 @@ void is_symmetric_mpi_wrapper(long double* time) {
     is_symmetric_mpi(cfg->CURR_COMM, cfg->MATRIX, cfg->MATRIX_DIMENSION, rank, size, time, cfg->VERBOSE_LEVEL);
 }
 
+// MATRIX is read as symmetric through its upper triangle, RESULT gets the symmetric matrix back
+void packed_scatter_gather_mpi_wrapper(long double* time) {
+    Config* cfg = get_config();
+
+    int rank, size;
+    MPI_Comm_rank(cfg->CURR_COMM, &rank);
+    MPI_Comm_size(cfg->CURR_COMM, &size);
+
+    packed_scatter_gather_mpi(cfg->CURR_COMM, cfg->MATRIX, cfg->RESULT, cfg->MATRIX_DIMENSION, rank, size,
+                              cfg->BLOCK_SIZE, time, cfg->VERBOSE_LEVEL);
+}
+
 void transpose_mpi_wrapper(long double* time) {
     Config* cfg = get_config();
 
@@ -269,3 +866,22 @@ void nonblocking_transpose_mpi_wrapper(long double* time) {
 
     MPI_Barrier(cfg->CURR_COMM);
 }
+
+void streaming_transpose_mpi_wrapper(long double* time) {
+    Config* cfg = get_config();
+
+    int rank, size;
+    MPI_Comm_rank(cfg->CURR_COMM, &rank);
+    MPI_Comm_size(cfg->CURR_COMM, &size);
+
+    // Writes into RESULT, so the root never holds more than the source, the result and the staging buffer
+    streaming_transpose_mpi(cfg->CURR_COMM, cfg->MATRIX, cfg->RESULT, cfg->MATRIX_DIMENSION, rank, size,
+                            (size_t)cfg->MPI_STAGING_MB << 20, time, cfg->VERBOSE_LEVEL);
+}
+
+void mpi_plan_wrapper(long double* time) {
+    Config* cfg = get_config();
+
+    // The plan is built by kernel setup for the current size and communicator, so this only moves data
+    mpi_plan_execute(cfg->MPI_PLAN, cfg->MATRIX, cfg->RESULT, time);
+}
@@ -0,0 +1,246 @@
+#include "../include/work_stealing.h"
+#include "../include/config.h"
+#include "../include/perf_counters.h"
+#include "../include/thread_stats.h"
+#include "../include/trace.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Halving n d times only ever gives floor(n / 2^d) or ceil(n / 2^d), so an extent is stored
+// as a 5 bit depth and a rounding bit instead of its value
+static uint64_t extent_code(int n, int extent) {
+    for (int d = 0; d < 32; d++) {
+        long down = (long)n >> d;
+        long up = ((long)n + (1L << d) - 1) >> d;
+        if (down == extent) {
+            return (uint64_t)d << 1;
+        }
+        if (up == extent) {
+            return (uint64_t)d << 1 | 1;
+        }
+    }
+    return 0;
+}
+
+static int extent_value(int n, uint64_t code) {
+    int d = (int)(code >> 1);
+    return (int)((code & 1) ? ((long)n + (1L << d) - 1) >> d : (long)n >> d);
+}
+
+// 26 bit first row and first column, then the two 6 bit extent codes
+static WSTask pack_task(int n, int row, int col, int rows, int cols) {
+    return (uint64_t)row << 38 | (uint64_t)col << 12 | extent_code(n, rows) << 6 | extent_code(n, cols);
+}
+
+static void unpack_task(int n, WSTask task, int* row, int* col, int* rows, int* cols) {
+    *row = (int)(task >> 38 & 0x3ffffff);
+    *col = (int)(task >> 12 & 0x3ffffff);
+    *rows = extent_value(n, task >> 6 & 0x3f);
+    *cols = extent_value(n, task & 0x3f);
+}
+
+int ws_push(WSDeque* deque, WSTask task) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= WS_DEQUE_CAPACITY) {
+        return 0;
+    }
+    atomic_store_explicit(&deque->buffer[bottom % WS_DEQUE_CAPACITY], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return 1;
+}
+
+int ws_take(WSDeque* deque, WSTask* task) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return 0;
+    }
+
+    *task = atomic_load_explicit(&deque->buffer[bottom % WS_DEQUE_CAPACITY], memory_order_relaxed);
+    if (top == bottom) {
+        // Last element: race the thieves for it
+        int won = atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                          memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return won;
+    }
+    return 1;
+}
+
+int ws_steal(WSDeque* deque, WSTask* task) {
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom) {
+        return 0;
+    }
+
+    *task = atomic_load_explicit(&deque->buffer[top % WS_DEQUE_CAPACITY], memory_order_relaxed);
+    return atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                   memory_order_seq_cst, memory_order_relaxed);
+}
+
+typedef struct {
+    float** src;
+    float** dst;
+    int n;
+    int block_size;
+    int threads;
+    WSDeque* deques;
+    atomic_long remaining;      // cells not transposed yet, the pool stops at 0
+} WSPool;
+
+static void transpose_leaf(const WSPool* pool, int row, int col, int rows, int cols) {
+    for (int i = row; i < row + rows; i++) {
+        for (int j = col; j < col + cols; j++) {
+            pool->dst[j][i] = pool->src[i][j];
+        }
+    }
+}
+
+// Child first: the first quadrant is carried on at once and its siblings are pushed for thieves
+static void run_task(WSPool* pool, WSDeque* own, WSTask task) {
+    int row, col, rows, cols;
+    unpack_task(pool->n, task, &row, &col, &rows, &cols);
+
+    while (rows > pool->block_size || cols > pool->block_size) {
+        int half_rows = rows > pool->block_size ? rows / 2 : rows;
+        int half_cols = cols > pool->block_size ? cols / 2 : cols;
+
+        // Pushed in reverse so that the quadrant next to the current one is taken back first
+        if (half_rows < rows && half_cols < cols) {
+            WSTask corner = pack_task(pool->n, row + half_rows, col + half_cols, rows - half_rows, cols - half_cols);
+            if (!ws_push(own, corner)) {
+                run_task(pool, own, corner);
+            }
+        }
+        if (half_rows < rows) {
+            WSTask below = pack_task(pool->n, row + half_rows, col, rows - half_rows, half_cols);
+            if (!ws_push(own, below)) {
+                run_task(pool, own, below);
+            }
+        }
+        if (half_cols < cols) {
+            WSTask right = pack_task(pool->n, row, col + half_cols, half_rows, cols - half_cols);
+            if (!ws_push(own, right)) {
+                run_task(pool, own, right);
+            }
+        }
+
+        rows = half_rows;
+        cols = half_cols;
+    }
+
+    TRACE_BEGIN("task");
+    double leaf_start = thread_stats_begin();
+    transpose_leaf(pool, row, col, rows, cols);
+    thread_stats_busy(leaf_start, 1);
+    TRACE_END("task");
+
+    atomic_fetch_sub_explicit(&pool->remaining, (long)rows * cols, memory_order_release);
+}
+
+static void run_worker(WSPool* pool, int self) {
+    WSDeque* own = &pool->deques[self];
+    WSTask task;
+
+    while (atomic_load_explicit(&pool->remaining, memory_order_acquire) > 0) {
+        if (ws_take(own, &task)) {
+            run_task(pool, own, task);
+            continue;
+        }
+
+        // Victims in order of ring distance, so that threads pinned next to each other
+        // (--bind compact) steal from their neighbours first
+        int stolen = 0;
+        for (int distance = 1; distance < pool->threads && !stolen; distance++) {
+            int victim = distance % 2 ? self + (distance + 1) / 2 : self - distance / 2;
+            victim = ((victim % pool->threads) + pool->threads) % pool->threads;
+            if (victim != self && ws_steal(&pool->deques[victim], &task)) {
+                stolen = 1;
+            }
+        }
+
+        if (stolen) {
+            run_task(pool, own, task);
+        }
+    }
+}
+
+float** transpose_cache_oblivious_ws(float** matrix, int n, long double* time) {
+    struct timespec start, end;
+    Config* cfg = get_config();
+
+    if (n > 1 << 26) {
+        fprintf(stderr, "The work-stealing transpose supports matrices up to 2^26 x 2^26\n");
+        exit(EXIT_FAILURE);
+    }
+
+    float** transposed = malloc(n * sizeof(float*));
+    if (transposed == NULL) {
+        fprintf(stderr, "Memory allocation failed for transposed matrix\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        transposed[i] = malloc(n * sizeof(float));
+        if (transposed[i] == NULL) {
+            fprintf(stderr, "Memory allocation failed for transposed[%d]\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    int threads = omp_get_max_threads();
+    WSDeque* deques = NULL;
+    if (posix_memalign((void**)&deques, 64, threads * sizeof(WSDeque)) != 0) {
+        fprintf(stderr, "Memory allocation failed for the work-stealing deques\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < threads; t++) {
+        atomic_init(&deques[t].top, 0);
+        atomic_init(&deques[t].bottom, 0);
+    }
+
+    WSPool pool = {matrix, transposed, n, cfg->BLOCK_SIZE > 0 ? cfg->BLOCK_SIZE : 1, threads, deques, 0};
+    atomic_init(&pool.remaining, (long)n * n);
+
+    // The whole matrix starts on the deque of thread 0, the others steal their way in
+    ws_push(&deques[0], pack_task(n, 0, 0, n, n));
+
+    perf_counters_begin();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        double region_start = thread_stats_begin();
+
+        // A smaller team than requested only has fewer thieves
+        #pragma omp single
+        pool.threads = omp_get_num_threads();
+
+        run_worker(&pool, omp_get_thread_num());
+
+        #pragma omp barrier
+        thread_stats_end(region_start);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    perf_counters_end();
+    *time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    free(deques);
+
+    if (cfg->VERBOSE_LEVEL > 1) {
+        printf("Computed the cache-oblivious transpose using work stealing in: %Lf\n", *time);
+    }
+
+    return transposed;
+}